@@ -21,11 +21,43 @@ namespace vernier {
         BitmapThumbnail bitmapThumbnail;
         std::vector<cv::Mat> bitmap;
         int bitmapIndex;
+        double bitmapCorrelation;
+
+        int dftSize;
+        std::vector<cv::Mat> bitmapSpectra;
+        cv::Mat paddedThumbnail, thumbnailSpectrum, spectrumProduct, correlation;
 
         void readJSON(const rapidjson::Value& document) override;
 
+        /** Sets the size of the DFTs and clears the cached spectra of the bitmaps. 
+         * The spectra are then computed when the bitmaps are first matched and 
+         * kept as long as the thumbnails fit in this size.
+         */
+        void resetBitmapSpectra(int dftSize);
+
+        /** Computes the spectrum of the bitmap k after removing its mean and 
+         * padding it to a square of dftSize pixels
+         */
+        void computeBitmapSpectrum(int k);
+
+        /** Correlates the bitmap k with the thumbnail using the cached spectra
+         * (same result as cv::matchTemplate with TM_CCOEFF)
+         */
+        void matchBitmap(int k, cv::Mat& result);
+
+        /** Returns the normalized correlation coefficient (between -1 and 1) of
+         * the bitmap k and the thumbnail at the given location of the result of
+         * matchBitmap, from the correlation found at this location
+         */
+        double getCorrelationCoefficient(int k, const cv::Point& location, double correlation);
+
         void computeAbsolutePose();
 
+        /** Estimates the absolute pose by matching only the given bitmaps (the
+         * correlation coefficient of the best match is kept in bitmapCorrelation)
+         */
+        void computeAbsolutePose(const std::vector<int>& candidates);
+
         void computeImage() override;
 
     public:
@@ -23,8 +23,22 @@ namespace vernier {
 
         void readJSON(const rapidjson::Value & document) override;
 
+        /** Visits the set cells of the bitmap placed on a grid with the given 
+         * pitch. When the dots are merged, the runs of set cells of each row are
+         * merged into a rectangle which is extended over the next rows having 
+         * the same run.
+         */
+        void visitBitmap(const RectangleVisitor & visitor, const Rectangle & region, double pitch);
+
     public:
 
+        /** If true, the adjacent dots are merged into larger rectangles when the
+         * layout is exported. The dots are only merged if they touch each other 
+         * (i.e. if the dot size is not smaller than the pitch of the bitmap), so 
+         * the exported geometry is unchanged.
+         */
+        bool mergeDots;
+
         BitmapPatternLayout();
 
         BitmapPatternLayout(double period, int nRows, int nCols);
@@ -36,7 +50,9 @@ namespace vernier {
 
         double getIntensity(double x, double y) override;
 
-        void toRectangleVector(std::vector<Rectangle>& rectangleList) override;
+        void getIntensities(const double * x, const double * y, double * intensities, int count) override;
+
+        void visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) override;
         
         int numberOfWrongEdges();
         
@@ -44,6 +60,10 @@ namespace vernier {
         
         int numberOfCorrectEdges();
 
+        bool getBool(const std::string & attribute) override;
+
+        void setBool(const std::string & attribute, bool value) override;
+
     };
 
 }
@@ -8,6 +8,7 @@
 #define CUSTOMPATTERNLAYOUT_HPP
 
 #include "PatternLayout.hpp"
+#include "Spatial.hpp"
 
 namespace vernier {
 
@@ -19,6 +20,13 @@ namespace vernier {
         
         std::vector<Rectangle> dots;
         std::vector<double> dotsIntensity;
+        
+        UniformGrid grid;
+
+        /** Builds the uniform grid which indexes the dots by the cells covered 
+         * by their areas of influence
+         */
+        void buildGrid();
 
         void writeJSON(std::ofstream & file) override;
 
@@ -28,6 +36,7 @@ namespace vernier {
 
         CustomPatternLayout();
 
+        /** Computes the size of the layout and indexes the dots (must be called each time the dots are modified) */
         void resize();
 
         /** Initializes a pattern from a CSV file */
@@ -35,11 +44,13 @@ namespace vernier {
 
         double getIntensity(double x, double y) override;
 
+        void getIntensities(const double * x, const double * y, double * intensities, int count) override;
+
         double getPhase1(double x, double y) override;
 
         double getPhase2(double x, double y) override;
 
-        void toRectangleVector(std::vector<Rectangle>& rectangleList) override;
+        void visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) override;
 
     };
 
@@ -10,6 +10,7 @@
 #include "PeriodicPatternDetector.hpp"
 #include "QRCodeDetector.hpp"
 #include "PatternPhase.hpp"
+#include "MarkerWorker.hpp"
 #include <map>
 
 namespace vernier {
@@ -18,12 +19,18 @@ namespace vernier {
     protected:
 
         Eigen::ArrayXXd window;
-        Eigen::ArrayXXd snapshot;
         int numberHalfPeriods;
         int snapshotSize;
+        std::vector<std::shared_ptr<MarkerWorker> > workers;
+        std::vector<unsigned long> codeIds;
+        std::vector<Pose> codePoses;
+        std::vector<char> codeFound;
 
         void readJSON(const rapidjson::Value& document)  override;
         
+        /** Estimates the poses of the detected codes in parallel (one worker 
+         * per thread) and merges them in the order of the codes.
+         */
         void computeImage() override;
 
         unsigned long readNumber(QRCode& code, const cv::Mat& image, double dotSize);
@@ -65,6 +72,12 @@ namespace vernier {
 
         void showControlImages() override;
 
+        /** Sets a boolean attribute ("trackingMode" enables the search of the 
+         * codes around their previous positions in video frames) */
+        void setBool(const std::string & attribute, bool value) override;
+
+        bool getBool(const std::string & attribute) override;
+
     };
 
 }
@@ -32,7 +32,9 @@ namespace vernier {
 
         double getIntensity(double x, double y) override;
 
-        void toRectangleVector(std::vector<Rectangle>& rectangleList) override;
+        void getIntensities(const double * x, const double * y, double * intensities, int count) override;
+
+        void visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) override;
         
         std::string toString() override;
 
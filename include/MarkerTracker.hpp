@@ -0,0 +1,69 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#ifndef MARKERTRACKER_HPP
+#define MARKERTRACKER_HPP
+
+#include "Common.hpp"
+
+namespace vernier {
+
+    /** \brief Regions of interest of a video frame around the markers found in
+     * the previous frame.
+     * 
+     * In tracking mode, the marker detectors (squares, QR codes) only search
+     * the markers in padded regions around their previous positions. The full
+     * frame is searched every fullSearchPeriod frames, when no marker was found
+     * in the previous frame or when a marker is lost in the regions.
+     */
+    class MarkerTracker {
+    private:
+
+        std::vector<cv::Point2d> centers;
+        std::vector<double> radii;
+        int framesSinceFullSearch;
+
+    public:
+
+        /** Enables the search in the regions of interest */
+        bool trackingMode;
+
+        /** Margin added around the previous markers (relative to their radius) */
+        double margin;
+
+        /** Maximal number of frames between two full frame searches */
+        int fullSearchPeriod;
+
+        /** Constructs a tracker (tracking mode disabled) */
+        MarkerTracker();
+
+        /** Forgets the previous markers (the next frame is fully searched) */
+        void reset();
+
+        /** Returns the regions of interest where the markers of the next frame
+         * are searched (the overlapping regions are merged), or an empty vector 
+         * if the full frame must be searched.
+         * 
+         *	\param imageSize: size of the next frame
+         */
+        std::vector<cv::Rect> getRegions(cv::Size imageSize);
+
+        /** Records the markers found in a frame. Returns false if the search 
+         * was limited to the regions of interest and lost some of the previous
+         * markers, i.e. a previous marker has no new marker within its radius
+         * (the markers are not recorded and the full frame must then be 
+         * searched).
+         * 
+         *	\param centers: centers of the found markers
+         *	\param radii: radii of the found markers
+         *	\param fullSearch: true if the markers have been searched in the full frame
+         */
+        bool update(const std::vector<cv::Point2d>& centers, const std::vector<double>& radii, bool fullSearch);
+
+    };
+}
+
+#endif
\ No newline at end of file
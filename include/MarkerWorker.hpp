@@ -0,0 +1,60 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#ifndef MARKERWORKER_HPP
+#define MARKERWORKER_HPP
+
+#include "Common.hpp"
+#include "PatternPhase.hpp"
+#include <memory>
+
+namespace vernier {
+
+    /** \brief Workspace used to compute the phase planes around one marker of 
+     * an image. 
+     * 
+     * The marker detectors (stamps, HP codes) keep one worker per thread so 
+     * that the markers found in an image are processed in parallel, each 
+     * thread reusing its own snapshot and FFT plans from one image to another.
+     */
+    class MarkerWorker {
+    public:
+
+        Eigen::ArrayXXd snapshot;
+        PatternPhase patternPhase;
+
+        /** Constructs a worker for square snapshots
+         *
+         *	\param snapshotSize: width and height of the snapshots in pixels
+         */
+        MarkerWorker(int snapshotSize);
+
+        /** Computes the phase planes of the windowed snapshot of the array 
+         * centered on a marker. Returns true if the peaks of the pattern are 
+         * found. The snapshot without window is not taken (see takeSnapshot).
+         *
+         *	\param array: image containing the markers
+         *	\param x, y: position of the center of the marker in the image
+         *	\param window: window applied to the snapshot (same size)
+         */
+        bool compute(const Eigen::ArrayXXd& array, int x, int y, const Eigen::ArrayXXd& window);
+
+        /** Copies the snapshot of the array centered on a marker (without window) */
+        void takeSnapshot(const Eigen::ArrayXXd& array, int x, int y);
+
+        /** Returns the number of workers needed to use all the threads */
+        static int getThreadCount();
+
+        /** Returns the index of the worker of the calling thread */
+        static int getThreadIndex();
+
+        /** Adds workers to the pool until there is one per thread */
+        static void createWorkers(std::vector<std::shared_ptr<MarkerWorker> >& workers, int snapshotSize);
+
+    };
+}
+
+#endif
\ No newline at end of file
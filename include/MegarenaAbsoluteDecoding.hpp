@@ -11,15 +11,25 @@
 #define MEGARENAABSOLUTEDECODING_HPP
 
 #include "Common.hpp"
+#include "MegarenaPackedSequence.hpp"
 
 namespace vernier {
 
     /** \brief Finds the place of the coding sample extracted from the pattern in the full coded sequence. **/
     class MegarenaAbsoluteDecoding {
     private:
-        Eigen::ArrayXXi bitSequence;
+        MegarenaPackedSequence codeBits;
+        int sequenceLength;
+        MegarenaPackedSequence sampleBits[3], sampleMask[3];
         Eigen::Array33d sumOnlyDotsRemain;
 
+        /** Position of the last bit of each window of windowWidth consecutive coding bits (-1 if absent) */
+        std::vector<int> windowPositions;
+        int windowWidth;
+
+        /** Indexes the windows of coding bits, the table is left empty if windows are not unique */
+        void buildWindowTable();
+
     public:
 
         /** Construct an empty constructor*/
@@ -31,12 +41,24 @@ namespace vernier {
          */
         MegarenaAbsoluteDecoding(Eigen::ArrayXXi& bitSequence);
 
+        /** Constructs the decoding class with the complete coded sequence
+         *
+         *	\param bitSequence: packed bit coded sequence
+         */
+        MegarenaAbsoluteDecoding(const MegarenaPackedSequence& bitSequence);
+
         /** resize the decoding class with the complete coded sequence
          *
          *	\param bitSequence: ArrayXXd containing the bit coded sequence
          */
         void resize(Eigen::ArrayXXi& bitSequence);
 
+        /** resize the decoding class with the complete coded sequence
+         *
+         *	\param bitSequence: packed bit coded sequence
+         */
+        void resize(const MegarenaPackedSequence& bitSequence);
+
         /** Get the two coded sequence binarized with the different array of dots
          *	\param numberWhiteDots : array containing the number of white dots of the pattern
          *	\param cumulWhiteDots : array containing the cumul of intensity of white dots of the pattern
@@ -52,6 +74,14 @@ namespace vernier {
         Eigen::ArrayXXd getCodeSequence(Eigen::ArrayXXd numberWhiteDots, Eigen::ArrayXXd cumulWhiteDots, Eigen::ArrayXXd numberBackgroundDots, Eigen::ArrayXXd cumulBackgroundDots, Eigen::VectorXd& codeOrientation);
 
         /** Finds where the sample coming from the pattern analysis fits in the complete coded sequence
+         *
+         *  The sample is correlated with the coded bits using hard decisions (positive 
+         *  values are 1, negative values are 0 and null values are ignored) and 
+         *  popcounts on 64-bit words. The candidate positions are given by the 
+         *  windows of consecutive sample bits found in the window table, so that 
+         *  the cost depends on the sample length and not on the sequence length. 
+         *  The whole sequence is scanned only if no window could be read or if 
+         *  the best candidate disagrees with more than 1/16 of the sample bits.
          *
          *	\param codingSample: sample coding coming from the pattern analysis
          */
@@ -8,18 +8,26 @@
 #define MEGARENABITSEQUENCE_HPP
 
 #include "Common.hpp"
+#include "MegarenaPackedSequence.hpp"
 
 namespace vernier {
 
     class MegarenaBitSequence {
     public:
 
+        /** Smallest and largest code depths available in the table of primitive polynomials */
+        static const int MIN_CODE_DEPTH = 4;
+        static const int MAX_CODE_DEPTH = 20;
+
         static void generate(int codeDepth, Eigen::ArrayXXi & sequence);
+        static void generate(int codeDepth, MegarenaPackedSequence & sequence);
         static bool check(int codeDepth, Eigen::ArrayXXi & bs);
         static int codeDepth(int sequenceLength);
 
+        /** Returns true if a sequence can be generated for this code depth */
+        static bool isValidCodeDepth(int codeDepth);
+
     private:
-        static int getBit(int state, int bitPosition);
         static int nextBit(int codeDepth, int state);
 
 
@@ -30,13 +30,21 @@ namespace vernier {
          *	\param thumbnailCumulWhiteDots : thumbnail containing the cumul of intensity at the center of each cell
          *
          **/
-        void getGlobalCell(Eigen::ArrayXXd thumbnailNumberWhiteDots, Eigen::ArrayXXd thumbnailCumulWhiteDots);
+        void getGlobalCell(const Eigen::ArrayXXd& thumbnailNumberWhiteDots, const Eigen::ArrayXXd& thumbnailCumulWhiteDots);
+
+        /** Sets the global cell of a pattern from the sums of the thumbnail cells grouped by their indexes modulo 3
+         *
+         *	\param numberWhiteDots : number of pixels at the center of the cells of each group
+         *	\param cumulWhiteDots : cumul of intensity at the center of the cells of each group
+         *
+         **/
+        void setGlobalCell(const Eigen::Array33d& numberWhiteDots, const Eigen::Array33d& cumulWhiteDots);
 
         /** Get the actual code orientation of the pattern modulo 3 by using the super cell
          *
          *	\param superCell : super cell representing the repartition of the white dots as a cell (3x3 dots)
          **/
-        Eigen::VectorXd getCodeOrientation();
+        const Eigen::VectorXd& getCodeOrientation();
 
         /** Simple getter to extract the global cell out of the class
          **/
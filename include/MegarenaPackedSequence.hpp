@@ -0,0 +1,105 @@
+/*
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#ifndef MEGARENAPACKEDSEQUENCE_HPP
+#define MEGARENAPACKEDSEQUENCE_HPP
+
+#include "Common.hpp"
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace vernier {
+
+    /** Returns the number of bits set in a 64-bit word */
+    inline int popcount64(uint64_t word) {
+#ifdef _MSC_VER
+        return (int) __popcnt64(word);
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+    /** \brief Bit sequence packed in 64-bit words (one bit per element instead of
+     * one int). It is used to store the megarena code sequences and to correlate
+     * them with the samples read in the images using word-parallel popcounts.
+     */
+    class MegarenaPackedSequence {
+    private:
+        std::vector<uint64_t> words;
+        int length;
+
+    public:
+
+        /** Constructs an empty sequence */
+        MegarenaPackedSequence();
+
+        /** Constructs a packed sequence from a single row array, non zero values being set to 1 */
+        MegarenaPackedSequence(const Eigen::ArrayXXi & sequence);
+
+        /** Resizes the sequence and clears all its bits (the memory is reused if the length does not grow) */
+        void resize(int length);
+
+        /** Sets all the bits to 0 */
+        void clear();
+
+        /** Sets all the bits to 1 */
+        void fill();
+
+        /** Returns the number of bits of the sequence */
+        inline int size() const {
+            return length;
+        }
+
+        /** Returns the bit at the given index (no bound check) */
+        inline bool get(int index) const {
+            return (words[index >> 6] >> (index & 63)) & 1;
+        }
+
+        /** Returns the bit at the given index (no bound check) */
+        inline bool operator()(int index) const {
+            return get(index);
+        }
+
+        /** Sets the bit at the given index (no bound check) */
+        inline void set(int index, bool value) {
+            if (value) {
+                words[index >> 6] |= (uint64_t) 1 << (index & 63);
+            } else {
+                words[index >> 6] &= ~((uint64_t) 1 << (index & 63));
+            }
+        }
+
+        /** Returns the 64 bits starting at the given position, bits outside the sequence are 0 */
+        uint64_t getWord(int position) const;
+
+        /** Returns a mask of the 64 bits starting at the given position which are inside the sequence */
+        uint64_t getRangeMask(int position) const;
+
+        /** Returns the number of bits set to 1 */
+        int count() const;
+
+        /** Extracts one bit every step bits, starting at index start */
+        void decimate(int start, int step, MegarenaPackedSequence & output) const;
+
+        /** Returns the hard-decision correlation with a sample placed at the given
+         * position, i.e. the number of agreeing bits minus the number of disagreeing
+         * bits. Only the bits set in the sample mask and overlapping the sequence
+         * are taken into account.
+         *
+         *	\param sample: sample bits
+         *	\param mask: sample bits to consider (same size as sample)
+         *	\param position: position of the first sample bit in the sequence (can be negative)
+         */
+        int correlate(const MegarenaPackedSequence & sample, const MegarenaPackedSequence & mask, int position) const;
+
+        /** Converts the sequence into a single row array of 0 and 1 */
+        Eigen::ArrayXXi toArray() const;
+    };
+}
+
+#endif
@@ -16,19 +16,55 @@ namespace vernier {
     /** \brief Class to estimate the absolute pose of periodic encoded patterns with subpixel resolutions.
      */
     class MegarenaPatternDetector : public PeriodicPatternDetector {
+    private:
+
+        /** Sets the class name and the initial state of the decoding and of 
+         * the tracking (common to all the constructors)
+         */
+        void initialize();
+
     protected:
         
-        Eigen::ArrayXXi bitSequence;
+        MegarenaPackedSequence bitSequence;
         MegarenaAbsoluteDecoding decoding;
         MegarenaThumbnail thumbnail;
+        Eigen::ArrayXXd codeSample1, codeSample2;
+        
+        int orientation;
+        bool trackingMode, tracked, previousPoseFound;
+        int trackingRange, trackingBitCount;
+        PhasePlane previousPlane1, previousPlane2;
+        int previousShift1, previousShift2;
+        std::vector<double> dotIntensities, bitSums;
+        std::vector<bool> dotExpected, bitExpected;
 
         void readJSON(const rapidjson::Value& document) override;
 
         void computeAbsolutePose();
         
+        /** Predicts the orientation and the period shifts from the previous frame
+         * and checks them against a few code bits read in the image. Returns false
+         * if no prediction matches the image (a full decoding is then required).
+         */
+        bool trackAbsolutePose();
+        
+        /** Reads the dots around the image center assuming the given oriented 
+         * planes and period shifts, and returns true if they match the bit 
+         * sequence (both the code bits and the positions of the missing dots).
+         */
+        bool checkCodeBits(PhasePlane& oriented1, PhasePlane& oriented2, int shift1, int shift2);
+        
+        /** Returns the intensity of the image at the position of the pattern
+         * where the oriented phases are equal to 2*pi*index1 and 2*pi*index2, or
+         * NAN if this position is outside the image.
+         */
+        double getDotIntensity(PhasePlane& oriented1, PhasePlane& oriented2, double index1, double index2);
+        
+        /** Applies one of the four orientation changes found by the decoding to a pair of planes */
+        static void orientPlanes(int orientation, PhasePlane& plane1, PhasePlane& plane2);
+        
         void computeImage() override;
 
-        
 
     public:
 
@@ -57,11 +93,30 @@ namespace vernier {
         void draw(cv::Mat& image) override;
         
         /** Returns the computed thumbnail of the image given to the megarena detector
+         * (in tracking mode, it is only updated by the frames which are fully decoded)
          */
         MegarenaThumbnail getThumbnail();
+        
+        /** Enables or disables the tracking mode. In tracking mode, the absolute 
+         * position found in the previous frame is used to predict the orientation 
+         * and the period shifts of the new frame. The prediction is checked with 
+         * a few code bits read directly in the image and the thumbnail computation
+         * and the full decoding are only done when the check fails (first frame, 
+         * large displacements or rotations, pattern lost).
+         */
+        void setTrackingMode(bool trackingMode);
+        
+        /** Returns true if the last pose has been obtained by tracking (without full decoding) */
+        bool isTracked();
+
+        void setInt(const std::string & attribute, int value) override;
 
         int getInt(const std::string & attribute) override;
 
+        void setBool(const std::string & attribute, bool value) override;
+
+        bool getBool(const std::string & attribute) override;
+
         void* getObject(const std::string & attribute) override;
 
     };
@@ -8,6 +8,7 @@
 #define MEGARENAPATTERNLAYOUT_HPP
 
 #include "PeriodicPatternLayout.hpp"
+#include "MegarenaPackedSequence.hpp"
 
 namespace vernier {
 
@@ -17,13 +18,36 @@ namespace vernier {
     class MegarenaPatternLayout : public PeriodicPatternLayout {
     private:
 
-        Eigen::ArrayXXi bitSequence;
+        MegarenaPackedSequence bitSequence;
         int codeDepth;
 
         void writeJSON(std::ofstream & file) override;
 
         void readJSON(const rapidjson::Value & document) override;
 
+        /** Returns the range of rows and columns of the dots inside the region of interest */
+        void getRegionOfInterestBounds(int & rowStart, int & rowStop, int & colStart, int & colStop);
+
+        /** Renders a row of the PNG image directly from the bit sequence: the
+         * dots are on the even rows and columns and a row of dots is the product
+         * of its row bit by the column bits */
+        void renderPNGRow(int row, int colStart, int colStop, unsigned char * pixels) override;
+
+#ifndef WIN32
+        /** Creates a GDS cell with the dots of a row of the pattern, made of 
+         * references to the unit dot repeated along the runs of consecutive bits 
+         * of the sequence (the dots of the columns multiple of 3 are skipped in 
+         * the rows multiple of 3).
+         */
+        gdstk::Cell * createGDSRowCell(const std::string & name, gdstk::Cell * dotCell, int colStart, int colStop, bool missingDots);
+
+        /** Creates a cell with the dots of a row of the pattern for the OASIS 
+         * export, stored as a single rectangle repeated at the columns of the 
+         * bits set in the sequence.
+         */
+        gdstk::Cell * createOASISRowCell(const std::string & name, int colStart, int colStop, bool missingDots);
+#endif
+
     public:
 
         Rectangle regionOfInterest;
@@ -36,7 +60,7 @@ namespace vernier {
 
         void resize(double period);
 
-        void toRectangleVector(std::vector<Rectangle> & rectangleList) override;
+        void visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) override;
 
         double getIntensity(double x, double y) override;
 
@@ -44,7 +68,28 @@ namespace vernier {
 
         double getPhase2(double x, double y) override;
 
+        void getIntensities(const double * x, const double * y, double * intensities, int count) override;
+
+        void getPhases(const double * x, const double * y, double * phases1, double * phases2, int count) override;
+
         void saveToPNG(std::string filename = "") override;
+
+#ifndef WIN32
+        /** Creates a new GDS cell of the pattern layout built hierarchically: a 
+         * unit dot cell, two row cells (with and without the missing dots) and 
+         * references to the rows repeated along the runs of consecutive bits of 
+         * the sequence. The memory and the file size scale with the code length 
+         * instead of the number of dots.
+         */
+        gdstk::Cell * convertToGDSCell(std::string name = "") override;
+
+        /** Creates a new cell of the pattern layout for the OASIS export, with the
+         * same hierarchy as the GDS cell but where each row cell is a single 
+         * rectangle and each kind of row a single reference, both with arbitrary
+         * repetitions.
+         */
+        gdstk::Cell * convertToOASISCell(std::string name = "") override;
+#endif
         
         std::string toString() override;
 
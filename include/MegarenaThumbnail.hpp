@@ -21,11 +21,26 @@ namespace vernier {
         Eigen::VectorXd codeOrientation;
         Eigen::ArrayXXd numberWhiteDots, cumulWhiteDots, numberBackgroundDots, cumulBackgroundDots;
         Eigen::VectorXd sequence1, sequence2;
-        Eigen::VectorXd numberWhiteRefDots1, cumulWhiteRefDots1, numberBackRefDots1, cumulBackRefDots1, numberCodingDots1, cumulCodingDots1, meanCodingDots1, meanBackRefDots1, meanWhiteRefDots1;
-        Eigen::VectorXd numberWhiteRefDots2, cumulWhiteRefDots2, numberBackRefDots2, cumulBackRefDots2, numberCodingDots2, cumulCodingDots2, meanCodingDots2, meanBackRefDots2, meanWhiteRefDots2;
+        /** Sums of the white dots of each row (resp. column) of the thumbnail, split
+         *  according to the column (resp. row) index modulo 3, and sums of the
+         *  background dots of each row (resp. column)
+         */
+        Eigen::ArrayX3d rowNumberWhiteDots, rowCumulWhiteDots, colNumberWhiteDots, colCumulWhiteDots;
+        Eigen::VectorXd rowNumberBackgroundDots, rowCumulBackgroundDots, colNumberBackgroundDots, colCumulBackgroundDots;
         int MSB1, MSB2;
         MegarenaCell cell;
 
+        /** Goes once through the whole thumbnail to compute the sums of the rows 
+         *  and columns and the global cell
+         */
+        void computeLineSums();
+
+        /** Removes a column of the thumbnail from the sums of the rows */
+        void removeFromRowSums(int col);
+
+        /** Removes a row of the thumbnail from the sums of the columns */
+        void removeFromColSums(int row);
+
     public:
         Eigen::ArrayXXd codeIntensity1, codeIntensity2;
 
@@ -41,13 +56,16 @@ namespace vernier {
         int getLength(PhasePlane plane, int nRows, int nCols);
 
         /** Resizes every array and vector used for the later computation of the thumbnail
+         *  and clears them (no memory is allocated if the lengths have not changed)
          *
          *	\param length1: length along one axis of the thumbnail (we can't know which one in advance)
          *	\param length2: length along the other axis of the thumbail
          */
         void resize(int length1, int length2);
 
-        /** Goes through the whole thumbnail and search for the binary coding values of the pattern*/
+        /** Searches for the binary coding values of the pattern from the sums of the 
+         *  rows and columns of the thumbnail (computeLineSums must have been called)
+         */
         void getCodeSequence();
 
         /**Computes the thumbnail and fill the arrays and vectors prepared in the resize method
@@ -96,11 +114,11 @@ namespace vernier {
         /** Displays with an arrow the orientation of the code ans where to pinpoint the position (0,0)*/
         void showCodeDirection();
 
-        Eigen::VectorXd getSequence1();
+        const Eigen::VectorXd& getSequence1();
 
-        Eigen::VectorXd getSequence2();
+        const Eigen::VectorXd& getSequence2();
 
-        Eigen::VectorXd getCodeOrientation();
+        const Eigen::VectorXd& getCodeOrientation();
 
         int getMSB1();
 
@@ -0,0 +1,71 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#ifndef PNGWRITER_HPP
+#define PNGWRITER_HPP
+
+#include "Common.hpp"
+#ifndef WIN32
+#include <zlib.h>
+#endif
+
+namespace vernier {
+
+    /** \brief Writes a grayscale PNG file row by row, so that images larger than
+     * the memory can be saved. The rows are compressed as soon as they are 
+     * given (with zlib) and only the compressed data is buffered. The pixels 
+     * can be stored on 8 bits or on a single bit (binary masks).
+     * 
+     * Without zlib (on Windows), the rows are gathered in an image saved with 
+     * OpenCV when the writer is closed.
+     */
+    class PNGWriter {
+    private:
+        std::string filename;
+        int width;
+        int height;
+        int bitDepth;
+        int rowCount;
+        bool closed;
+        std::vector<unsigned char> row;
+#ifndef WIN32
+        std::ofstream file;
+        z_stream stream;
+        std::vector<unsigned char> output;
+
+        void writeChunk(const char * type, const unsigned char * data, size_t length);
+
+        void compress(int flush);
+#else
+        cv::Mat image;
+#endif
+
+    public:
+
+        /** Opens a PNG file for an image of the given size
+         *
+         *   \param filename: name of the PNG file
+         *   \param width: number of columns of the image
+         *   \param height: number of rows of the image
+         *   \param bitDepth: number of bits per pixel, 8 or 1 (binary image)
+         **/
+        PNGWriter(const std::string & filename, int width, int height, int bitDepth = 8);
+
+        /** Closes the file if it has not been closed **/
+        ~PNGWriter();
+
+        /** Appends the next row of the image (width pixels with one byte per 
+         * pixel, for binary images a pixel is white if its value is above 127) **/
+        void writeRow(const unsigned char * pixels);
+
+        /** Ends the image (all the rows must have been written) and closes the file **/
+        void close();
+
+    };
+
+}
+
+#endif
\ No newline at end of file
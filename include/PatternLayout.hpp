@@ -8,12 +8,22 @@
 #define PATTERNLAYOUT_HPP
 
 #include "Common.hpp"
+#include <functional>
+#include <limits>
+#include <map>
 #ifndef WIN32
 #include <gdstk/gdstk.hpp>
 #endif
 
 namespace vernier {
 
+    /** Function called for each rectangle (dot) of a pattern layout */
+    typedef std::function<void(const Rectangle &)> RectangleVisitor;
+
+    /** Function called during the exports with the name of the current task 
+     * and its progress (between 0.0 and 1.0) */
+    typedef std::function<void(const std::string &, double)> ProgressCallback;
+
     /** \brief Abstract class to define the interface of pattern detectors. 
      * 
      * \example generatingPatternLayout.cpp 
@@ -28,6 +38,7 @@ namespace vernier {
         double height;
         double originX;
         double originY;
+        ProgressCallback progressCallback;
 
         virtual void writeJSON(std::ofstream & file);
 
@@ -35,6 +46,73 @@ namespace vernier {
 
         virtual void readJSON(const rapidjson::Value & document);
 
+        /** Returns the range [first, last) of the indexes i in [0, count) such 
+         * that origin + i * pitch is in [start, start + length). Adjacent ranges 
+         * always give contiguous indexes, without gap or overlap.
+         */
+        static void getGridRange(double start, double length, double origin, double pitch, int count, int & first, int & last);
+
+        /** Returns the number of threads used to process the tiles */
+        static int getThreadCount();
+
+        /** Reports the progress of a task to the progress callback (if any) */
+        void reportProgress(const std::string & task, double progress);
+
+        /** Splits the layout into horizontal tiles which are processed in 
+         * parallel, by batches of one tile per thread. The process function is 
+         * called with the index of the tile in the batch (from 0 to the number 
+         * of threads) and the region of the tile, then the merge function is 
+         * called in the order of the tiles with the same index. The tiles cover
+         * the whole plane without overlap.
+         */
+        void processTiles(const std::string & task, const std::function<void(int, const Rectangle &)> & process, const std::function<void(int)> & merge);
+
+        /** Writes the rectangles of the layout to a stream: the tiles are 
+         * serialized in parallel by the writer into separate buffers which are
+         * then written in order to the stream */
+        void writeTiles(std::ostream & stream, const std::string & task, const std::function<void(std::ostream &, const Rectangle &)> & writer);
+
+        /** Renders the intensity image of the pattern seen through the inverse 
+         * homography (from the image to the pattern plane). The columns are 
+         * rendered in parallel and the pattern points of a column are stepped
+         * from the first one, each pixel being averaged over supersampling^2 
+         * samples.
+         */
+        void renderHomography(const Eigen::Matrix3d & inversedHomography, Eigen::ArrayXXd & outputImage);
+
+        /** Renders the phase images of the pattern seen through the inverse 
+         * homography, in parallel as renderHomography (without supersampling) */
+        void renderPhaseHomography(const Eigen::Matrix3d & inversedHomography, Eigen::ArrayXXd & outputPhase1, Eigen::ArrayXXd & outputPhase2);
+
+        /** Writes a list of rectangles as SVG elements (the list is sorted). 
+         * Three or more identical dots evenly spaced along a row become a 
+         * single rectangle filled with a pattern, whose definition is added to
+         * the map of patterns (by identifier).
+         */
+        static void writeSVGRectangles(std::ostream & stream, std::vector<Rectangle> & rectangles, std::map<std::string, std::string> & patterns);
+
+#ifndef WIN32
+        /** Creates a new GDS cell containing a single square dot whose top left corner is at the origin */
+        static gdstk::Cell * createGDSDotCell(const std::string & name, double dotSize);
+
+        /** Appends to a GDS cell the references to another cell repeated on a grid
+         * of columns x rows with the given spacing. The grid is split into several
+         * references when it exceeds the size limit of the GDSII arrays.
+         */
+        static void appendGDSReferences(gdstk::Cell * cell, gdstk::Cell * referencedCell, gdstk::Vec2 origin, int columns, int rows, gdstk::Vec2 spacing);
+
+        /** Appends to a GDS cell a rectangle (defined by its top left corner) 
+         * repeated on a grid of columns x rows with the given spacing */
+        static void appendGDSRectangles(gdstk::Cell * cell, gdstk::Vec2 corner, double width, double height, int columns, int rows, gdstk::Vec2 spacing);
+
+        /** Appends to a GDS cell a rectangle (defined by its top left corner) 
+         * repeated at arbitrary positive offsets along x */
+        static void appendGDSRectangles(gdstk::Cell * cell, gdstk::Vec2 corner, double width, double height, const std::vector<double> & offsets);
+
+        /** Appends the description of the pattern below the layout in a GDS cell */
+        void appendGDSLabel(gdstk::Cell * cell, double size);
+#endif
+
         friend class Layout;
 
     public:
@@ -48,11 +126,22 @@ namespace vernier {
         double topMargin;
         double bottomMargin;
 
+        /** Number of samples per pixel along each axis used to antialias the 
+         * rendered intensity images (1 by default, no antialiasing) */
+        int supersampling;
+
         PatternLayout();
 
         virtual ~PatternLayout() {
         };
 
+        /** Sets the function called to report the progress of the exports 
+         * (by default printProgress, an empty function disables the reports) */
+        void setProgressCallback(ProgressCallback callback);
+
+        /** Prints the progress of a task on the standard output */
+        static void printProgress(const std::string & task, double progress);
+
         /** Initializes a pattern layout from a JSON file */
         void loadFromJSON(const std::string & filename);
 
@@ -69,8 +158,20 @@ namespace vernier {
         /** Creates a OASIS file corresponding to the pattern layout */
         void saveToOASIS(std::string filename = "");
 
-        /** Creates a new GDS cell corresponding to the pattern layout (must be deleted afterward) */
-        gdstk::Cell * convertToGDSCell(std::string name = "");
+        /** Creates a new GDS cell corresponding to the pattern layout. By default 
+         * the cell contains one polygon per dot, but the layouts made of repeated
+         * rows override it to build a hierarchy of cells (unit dot, rows...) 
+         * placed with references. The cell and all its dependencies must be freed
+         * afterward (with gdstk::Cell::free_all and gdstk::free_allocation).
+         */
+        virtual gdstk::Cell * convertToGDSCell(std::string name = "");
+
+        /** Creates a new cell for the OASIS export, where the identical dots are
+         * stored as rectangles with regular or arbitrary repetitions. By default 
+         * each row of dots becomes a single repeated rectangle and the evenly 
+         * spaced rows are merged. The cell must be freed as the GDS cells.
+         */
+        virtual gdstk::Cell * convertToOASISCell(std::string name = "");
 #endif
 
         /** Creates a CSV file listing all the dots of the pattern layout */
@@ -91,8 +192,33 @@ namespace vernier {
         /** Returns the phase2 of the pattern at point (x,y) */
         virtual double getPhase2(double x, double y) = 0;
 
-        /** Returns a vector listing all the dots of the pattern */
-        virtual void toRectangleVector(std::vector<Rectangle>& rectangleList) = 0;
+        /** Computes the intensities of the pattern at count points (x[i],y[i]). 
+         * The default implementation calls getIntensity for each point, the 
+         * layouts override it with a loop calling their own getIntensity without 
+         * virtual dispatch, so that it can be inlined (a layout overriding 
+         * getIntensity must also override getIntensities).
+         */
+        virtual void getIntensities(const double * x, const double * y, double * intensities, int count);
+
+        /** Computes the phase1 and the phase2 of the pattern at count points 
+         * (x[i],y[i]), as getIntensities for the phases */
+        virtual void getPhases(const double * x, const double * y, double * phases1, double * phases2, int count);
+
+        /** Calls the visitor for each rectangle (dot) of the pattern whose top 
+         * left corner is inside the given region. The rectangles are generated on
+         * the fly (nothing is stored), and tiling the layout with adjacent regions
+         * visits each rectangle exactly once.
+         */
+        virtual void visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) = 0;
+
+        /** Calls the visitor for each rectangle (dot) of the pattern */
+        void visitAllRectangles(const RectangleVisitor & visitor);
+
+        /** Returns the number of rectangles (dots) of the pattern */
+        size_t countRectangles();
+
+        /** Appends all the dots of the pattern to a vector (prefer visitAllRectangles for large layouts) */
+        void toRectangleVector(std::vector<Rectangle>& rectangleList);
 
         /** Renders an image with an orthographic projection defined by:
          * 
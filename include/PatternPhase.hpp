@@ -70,6 +70,15 @@ namespace vernier {
          *	\param image: image of a pattern in an Eigen::ArrayXXd
          */
         void compute(const Eigen::ArrayXXd& image);
+
+        /** Computes the phase planes of a windowed snapshot of an image. The 
+         * snapshot is written directly in the input of the FFT.
+         *
+         *	\param array: image containing the pattern in an Eigen::ArrayXXd
+         *	\param x, y: position of the center of the snapshot in the image
+         *	\param window: window applied to the snapshot (its size gives the size of the snapshot)
+         */
+        void compute(const Eigen::ArrayXXd& array, int x, int y, const Eigen::ArrayXXd& window);
           
         /** Computes the phase planes of a given pattern 
          *
@@ -123,6 +132,13 @@ namespace vernier {
 
         /** Returns the second phase plane*/
         PhasePlane getPlane2();
+
+        /** Returns the position (x = column, y = row) of the center of the 
+         * fringes relative to the center of the image. It is the centroid of the
+         * pixels where the product of the magnitudes of both filtered fringes 
+         * exceeds half of its maximum (i.e. where the pattern is visible).
+         */
+        Eigen::Vector2d getFringesCenter();
         
         /** Sets the ratio of pixels to crop from the border for the regression */
         void setCropFactor(double cropFactor);
@@ -20,10 +20,33 @@ namespace vernier {
         PatternPhase patternPhase;
         PhasePlane plane1, plane2;
         int periodShift1, periodShift2;
+        
+        int trackingWindowSize;
+        bool windowCentered, windowTracked;
+        int windowX, windowY;
+        Eigen::ArrayXXd trackingWindow;
 
         void readJSON(const rapidjson::Value& document) override;
         
+        /** Computes the phase planes of the image. If a tracking window size is 
+         * set and the pattern was found in the previous image, only a window of
+         * that size centered on the previous position of the pattern is computed
+         * (the full image is computed if the pattern is not found in the window).
+         * The planes are always expressed relative to the center of the image, 
+         * but the phase maps of the pattern phase only cover the window (the
+         * detectors which decode the phase maps must compute the full image).
+         */
         void computeImage() override;
+
+        /** Computes the phase planes of the whole image (the phase maps of the 
+         * pattern phase then cover the whole image)
+         */
+        void computeFullImage();
+
+        /** Centers the next tracking window on the fringes found by the last 
+         * computation
+         */
+        void centerTrackingWindow();
     
     public:
 
@@ -120,8 +143,18 @@ namespace vernier {
 
         int getRows();
 
+        /** Sets the size of the tracking window (even number of pixels, a power
+         * of two is faster). The pattern is searched in a window of this size 
+         * centered on the previous position of the pattern, so the computation
+         * time does not depend on the image size. A null size disables the 
+         * tracking window (default).
+         */
+        void setTrackingWindowSize(int trackingWindowSize);
+
         void setInt(const std::string & attribute, int value) override;
 
+        int getInt(const std::string & attribute) override;
+
         void setDouble(const std::string & attribute, double value) override;
 
         void setBool(const std::string & attribute, bool value) override;
@@ -24,9 +24,23 @@ namespace vernier {
 
         void readJSON(const rapidjson::Value & document) override;
 
+        /** Renders the pixels [colStart, colStop) of a row of the PNG image, 
+         * whose pixels are half a period wide (by default with getIntensities) */
+        virtual void renderPNGRow(int row, int colStart, int colStop, unsigned char * pixels);
+
+        /** Writes the rows [rowStart, rowStop) and the columns [colStart, colStop)
+         * of the PNG image. The rows are rendered in parallel by strips which 
+         * are compressed in the file one after the other, so the whole image is
+         * never stored in memory.
+         */
+        void writePNG(std::string filename, int rowStart, int rowStop, int colStart, int colStop);
+
     public:
 
         double dotSize;
+
+        /** Number of bits per pixel of the PNG files: 8 (default) or 1 (binary mask) */
+        int pngBitDepth;
         
         PeriodicPatternLayout();
 
@@ -40,7 +54,11 @@ namespace vernier {
 
         double getPhase2(double x, double y) override;
 
-        void toRectangleVector(std::vector<Rectangle>& rectangleList) override;
+        void getIntensities(const double * x, const double * y, double * intensities, int count) override;
+
+        void getPhases(const double * x, const double * y, double * phases1, double * phases2, int count) override;
+
+        void visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) override;
 
         void saveToPNG(const std::string filename = "") override;
         
@@ -56,6 +74,8 @@ namespace vernier {
 
         int getInt(const std::string & attribute) override;
         
+        void setInt(const std::string & attribute, int value) override;
+        
         void setDouble(const std::string & attribute, double value) override;
 
     };
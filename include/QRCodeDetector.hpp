@@ -8,6 +8,8 @@
 #define QRCODEDETECTOR_HPP
 
 #include "QRFiducialDetector.hpp"
+#include "MarkerTracker.hpp"
+#include "Spatial.hpp"
 
 namespace vernier {
     
@@ -37,13 +39,25 @@ namespace vernier {
     class QRCodeDetector {
     private:
 
-        std::vector<std::vector<double> > distance;
         std::vector<std::vector<int> > clusters;
 
-        void computeDistances();
+        UniformGrid grid;
+
+        /** Sorts the markers in a uniform grid (about one marker per cell) */
+        void computeGrid(int markerCount);
+
+        /** Returns the closest marker not assigned to a cluster, searching the 
+         * grid cells in rings of increasing size around the marker */
+        int findClosestMarker(int marker, const std::vector<bool>& assigned);
+
         void makeFirstClustering();
         void recordCodes();
 
+        /** Groups the found fiducials by three into codes */
+        void findCodes();
+
+        bool tracked;
+
     public:
 
         QRFiducialDetector fiducialDetector;
@@ -51,13 +65,26 @@ namespace vernier {
         /** Vector of detected codes (unsort) */
         std::vector<QRCode> codes;
 
+        /** Regions of interest around the codes of the previous frame (tracking mode) */
+        MarkerTracker tracker;
+
         /** Constructs a detector for QR codes */
         QRCodeDetector() : fiducialDetector() {
+            tracked = false;
         };
 
-        /** Detects QR codes in an image */
+        /** Detects QR codes in an image. In tracking mode, the fiducials are 
+         * only searched around the codes of the previous frame when possible
+         * (see MarkerTracker), and the control images of the fiducial detector
+         * are those of the last region. */
         void compute(const cv::Mat& image);
 
+        /** Enables or disables the tracking mode (the next frame is fully searched) */
+        void setTrackingMode(bool trackingMode);
+
+        /** Returns true if the last codes have been found in the regions of interest only */
+        bool isTracked();
+
         /** Draws the found codes in an image (detection must have been done before) */
         void draw(cv::Mat& image);
 
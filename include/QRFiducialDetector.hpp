@@ -24,6 +24,7 @@ namespace vernier {
         double getDotSize();
         void draw(cv::Mat& image, cv::Scalar color);
         friend class QRRowPattern;
+        friend class QRFiducialDetector;
     };
 
     class QRRowPattern {
@@ -38,6 +39,7 @@ namespace vernier {
         double getDotSize();
         void draw(cv::Mat& image, cv::Scalar color);
         bool isCrossing(QRColumnPattern& colPattern);
+        friend class QRFiducialDetector;
     };
 
     class QRFiducialPattern {
@@ -59,9 +61,26 @@ namespace vernier {
         std::vector<std::vector<int> > groupsOfColPatterns;
         std::vector<std::vector<int> > groupsOfRowPatterns;
 
+        /** Number of rows (or columns) of the bands of the Canny image scanned in parallel */
+        static const int SCAN_BAND_SIZE = 64;
+        std::vector<std::vector<QRRowPattern> > rowBandPatterns;
+        std::vector<std::vector<QRColumnPattern> > colBandPatterns;
+
         void findRowPatterns();
         void findColPatterns();
+
+        /** Finds the row patterns on the runs of the binary image: the six 
+         * boundaries of five consecutive runs are the edges of a pattern */
+        void findRowRunPatterns();
+
+        /** Finds the column patterns on the runs of the binary image */
+        void findColRunPatterns();
         void clearGroups();
+
+        /** Groups the crossing row and column patterns. The patterns are sorted
+         * by the scans (rows by row, columns by column), so the patterns 
+         * crossing a given one are searched by bisection in a range of rows 
+         * or columns instead of all the patterns. */
         void findGroupsOfPatterns();
         void sortFiducials();
 
@@ -73,6 +92,25 @@ namespace vernier {
         /** Grayscale image */
         cv::Mat grayImage;
 
+        /** Binary image (used by the run-length scan) */
+        cv::Mat binaryImage;
+
+        /** Detects the patterns on the runs of a binary image instead of the
+         * edges of the Canny image (no gradient image is computed) */
+        bool runLengthScan = false;
+
+        /** Size of the neighbourhood used to compute the local mean of the 
+         * binarization threshold (run-length scan) */
+        int thresholdBlockSize = 51;
+
+        /** Offset of the pixels above the local mean set in the binary image 
+         * (run-length scan) */
+        int thresholdOffset = 20;
+
+        /** Finds light finder patterns on a dark background instead of dark 
+         * finder patterns on a light background (run-length scan) */
+        bool lightFinders = false;
+
         /** Low threshold for the hysteresis procedure */
         int lowCannyThreshold = 100;
 
@@ -20,6 +20,9 @@ namespace vernier {
 
         Rectangle(double x, double y, double width, double height);
 
+        /** Returns true if the point (x,y) is inside the rectangle (the left and top edges are inside, the right and bottom edges outside) */
+        bool contains(double x, double y) const;
+
         std::string toString();
     };
 }
@@ -32,9 +32,63 @@ namespace vernier {
      */
     void quartersUnwrapPhase(Eigen::ArrayXXd& wrappedPhase);
 
+    /** Returns a square Hann window whose radial profile is raised to the given 
+     * exposure (the detectors compute their window once and keep it).
+     */
     Eigen::ArrayXXd hannWindow(int size, int exposure = 1);
 
+    /** Copies the square part of the array centered on (x, y) into the snapshot 
+     * (the pixels outside the array are set to zero)
+     */
     void takeSnapshot(int x, int y, int size, const Eigen::ArrayXXd & array, Eigen::ArrayXXd & snapshot);
 
+    /** Copies the square part of the array centered on (x, y) multiplied by the
+     * window into a complex snapshot (ready for the FFT) in a single pass. The 
+     * size of the snapshot is the size of the window and the pixels outside 
+     * the array are set to zero.
+     */
+    void takeWindowedSnapshot(int x, int y, const Eigen::ArrayXXd & array, const Eigen::ArrayXXd & window, Eigen::ArrayXXcd & snapshot);
+
+    /** \brief Uniform grid of square cells indexing points or rectangles by the
+     * cells they cover, for the neighbourhood searches.
+     * 
+     * The items are sorted by cell with a counting sort: the items of a cell 
+     * are between cellStarts[cell] and cellStarts[cell + 1] in cellItems, in 
+     * increasing order.
+     */
+    class UniformGrid {
+    public:
+
+        double left, top, right, bottom, cellSize;
+        int cols, rows;
+        std::vector<int> cellStarts, cellItems;
+
+        /** Constructs an empty grid */
+        UniformGrid();
+
+        /** Indexes the rectangles in the grid covering all of them. The cells are
+         * at least of the minimal size, and there are about cellsPerItem cells
+         * per rectangle on the square bounding the rectangles.
+         */
+        void build(const std::vector<Rectangle>& items, double minCellSize, double cellsPerItem);
+
+        /** Indexes the points (see the rectangles) */
+        void build(const std::vector<cv::Point2d>& items, double minCellSize, double cellsPerItem);
+
+        /** Returns the column of the abscissa x (not limited to the grid) */
+        int getCol(double x) const;
+
+        /** Returns the row of the ordinate y (not limited to the grid) */
+        int getRow(double y) const;
+
+        /** Returns the cell of the point (x, y), or -1 if it is outside the grid */
+        int getCell(double x, double y) const;
+
+        /** Appends the items of the cells covered by the region (unsorted, an 
+         * item covering several cells may be appended several times) */
+        void findItems(const Rectangle& region, std::vector<int>& items) const;
+
+    };
+
 }
 #endif
\ No newline at end of file
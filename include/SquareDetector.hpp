@@ -8,6 +8,7 @@
 #define SQUAREDETECTOR_HPP
 
 #include "Common.hpp"
+#include "MarkerTracker.hpp"
 
 namespace vernier {
     
@@ -28,6 +29,8 @@ namespace vernier {
         int minSideLengthCanonicalImg = 32;
         double minGroupDistance = 0.21f;
         int markerSize = 6;     
+        /** Stops the thresholding once two consecutive window sizes give the same candidates */
+        bool stopOnStableCandidates = false;
     };
     
     class Square {
@@ -62,6 +65,13 @@ namespace vernier {
     };
 
     class SquareDetector {
+    private:
+
+        bool tracked;
+
+        /** Detects the squares in an image and appends them shifted by an offset */
+        void detect(const cv::Mat& image, cv::Point2f offset);
+
     public:
 
         /** Parameters of the square detector (see OpenCV documention about ArUco detector) */
@@ -70,12 +80,23 @@ namespace vernier {
         /** Vector of detected squares (unsort) */
         std::vector<Square> squares;
 
+        /** Regions of interest around the squares of the previous frame (tracking mode) */
+        MarkerTracker tracker;
+
         /** Constructs a square detector */
         SquareDetector();
 
-        /** Detects squares in an image (type should be CV_8UC1) */
+        /** Detects squares in an image (type should be CV_8UC1). In tracking 
+         * mode, the squares are only searched around the squares of the 
+         * previous frame when possible (see MarkerTracker). */
         void compute(const cv::Mat& image);
 
+        /** Enables or disables the tracking mode (the next frame is fully searched) */
+        void setTrackingMode(bool trackingMode);
+
+        /** Returns true if the last squares have been found in the regions of interest only */
+        bool isTracked();
+
         /** Draws the found squares in an image (detection must have been done before) */
         void draw(cv::Mat& image);
 
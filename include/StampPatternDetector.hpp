@@ -11,7 +11,9 @@
 #include "SquareDetector.hpp"
 #include "PatternPhase.hpp"
 #include "BitmapThumbnail.hpp"
+#include "MarkerWorker.hpp"
 #include <map>
+#include <unordered_map>
 
 namespace vernier {
 
@@ -19,10 +21,44 @@ namespace vernier {
     protected:
 
         Eigen::ArrayXXd window;
-        Eigen::ArrayXXd snapshot;
+        int snapshotSize;
+        std::vector<std::shared_ptr<MarkerWorker> > workers;
+        std::vector<BitmapThumbnail> thumbnails;
+        std::vector<PhasePlane> squarePlanes1, squarePlanes2;
+        std::vector<char> squarePeaksFound;
+
+        int maxCandidates, shortlistedCount;
+        double minCorrelation;
+        std::unordered_map<unsigned int, std::vector<int> > patternIndex;
+        std::unordered_map<int, double> votes;
+        std::vector<int> candidates;
+        
+        /** Adds the local patterns of the bitmap k to the index */
+        void indexBitmap(int k);
+
+        /** Shortlists the bitmaps sharing the most local patterns with the 
+         * binary thumbnail. Each pattern votes for the bitmaps containing it 
+         * with a weight inversely proportional to their number, and the patterns
+         * common to many bitmaps (frame, shared text) are ignored.
+         */
+        void findCandidates();
+
+        /** Returns the 5x5 binary neighbourhood of a pixel packed in 25 bits */
+        static unsigned int getLocalPattern(const cv::Mat& binaryImage, int row, int col);
+
+        /** Calls the function for each local pattern centered on a white pixel
+         * lying between the dots of the stamp (the dots are common to all the 
+         * stamps and the bridges between them carry the identification marks)
+         */
+        template <typename Function>
+        static void forEachLocalPattern(const cv::Mat& binaryImage, int dotOffset, Function function);
         
         void readJSON(const rapidjson::Value& document) override;
 
+        /** Computes the phases and the thumbnails of the detected squares in 
+         * parallel (one worker per thread), then identifies the stamps and 
+         * estimates their poses in the order of the squares.
+         */
         void computeImage() override;
 
     public:
@@ -42,6 +78,10 @@ namespace vernier {
          */
         StampPatternDetector(double physicalPeriod, const std::string & filename, int snapshotSize);
 
+        /** Adds a new stamp to the detector (its id is the number of stamps 
+         * already added). The stamp is indexed by its local patterns so that 
+         * only a few candidate stamps are correlated with each detected square.
+         */
         void addBitmap(const std::string & filename);
         
         Pose get2DPose(int id = -1) override;
@@ -58,6 +98,28 @@ namespace vernier {
 
         void showControlImages() override;
 
+        /** Sets an integer attribute ("maxCandidates" is the size of the shortlist
+         * of bitmaps correlated with each square, 0 for a full search) */
+        void setInt(const std::string & attribute, int value) override;
+
+        /** Returns an integer attribute ("shortlistedCount" is the number of 
+         * stamps of the last image identified without a full search) */
+        int getInt(const std::string & attribute) override;
+
+        /** Sets a double attribute ("minCorrelation" is the correlation 
+         * coefficient under which the shortlist is replaced by a full search, 
+         * 0.96 by default: the stamps matched in a wrong rotation correlate 
+         * up to 0.95 and the right ones from 0.97) */
+        void setDouble(const std::string & attribute, double value) override;
+
+        double getDouble(const std::string & attribute) override;
+
+        /** Sets a boolean attribute ("trackingMode" enables the search of the 
+         * stamps around their previous positions in video frames) */
+        void setBool(const std::string & attribute, bool value) override;
+
+        bool getBool(const std::string & attribute) override;
+
     };
 
 }
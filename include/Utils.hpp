@@ -41,6 +41,12 @@ namespace vernier {
         return angle;
     }
 
+    /** Returns true if two lengths are equal up to the rounding errors of the 
+     * layout coordinates (relative tolerance) */
+    inline bool areClose(double a, double b, double relativeTolerance = 1e-9) {
+        return std::abs(a - b) <= relativeTolerance * std::max(std::abs(a), std::abs(b));
+    }
+
     const std::string currentDateTime();
 
     template<typename _Tp, int _rows, int _cols, int _options, int _maxRows, int _maxCols>  inline
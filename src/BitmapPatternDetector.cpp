@@ -13,6 +13,8 @@ namespace vernier {
     BitmapPatternDetector::BitmapPatternDetector()
     : PeriodicPatternDetector() {
         classname = "BitmapPattern";
+        dftSize = 0;
+        bitmapCorrelation = 0.0;
     }
 
     BitmapPatternDetector::BitmapPatternDetector(double physicalPeriod, const std::string & filename)
@@ -27,6 +29,8 @@ namespace vernier {
         for (int k = 0; k < 3; k++) {
             cv::rotate(bitmap[k], bitmap[k + 1], cv::ROTATE_90_CLOCKWISE);
         }
+        dftSize = 0;
+        bitmapCorrelation = 0.0;
     }
 
     void BitmapPatternDetector::readJSON(const rapidjson::Value & document) {
@@ -46,21 +50,113 @@ namespace vernier {
         if (length1 % 2 == 0) length1++;
         if (length2 % 2 == 0) length2++;
         bitmapThumbnail.resize(std::max(length1, length2));
-        bitmapThumbnail.compute(array, patternPhase.getPlane1(), patternPhase.getPlane2());
+        // the planes are relative to the center of the image, even if only the 
+        // tracking window has been computed
+        bitmapThumbnail.compute(array, plane1, plane2);
         
         computeAbsolutePose();
     }
 
+    void BitmapPatternDetector::resetBitmapSpectra(int dftSize) {
+        this->dftSize = dftSize;
+        bitmapSpectra.assign(bitmap.size(), cv::Mat());
+        paddedThumbnail.create(dftSize, dftSize, CV_32F);
+    }
+
+    void BitmapPatternDetector::computeBitmapSpectrum(int k) {
+        cv::Mat paddedBitmap = cv::Mat::zeros(dftSize, dftSize, CV_32F);
+        cv::Mat roi = paddedBitmap(cv::Rect(0, 0, bitmap[k].cols, bitmap[k].rows));
+        bitmap[k].convertTo(roi, CV_32F);
+        roi -= cv::mean(roi);
+        cv::dft(paddedBitmap, bitmapSpectra[k], 0, bitmap[k].rows);
+    }
+
+    void BitmapPatternDetector::matchBitmap(int k, cv::Mat& result) {
+        // TM_CCOEFF correlates the template minus its mean with the image, and 
+        // the mean of the image can also be removed since the template sums to
+        // zero: both are zero-mean here and the larger one is the image
+        cv::Size thumbnailSize = bitmapThumbnail.thumbnail.size();
+        cv::Size bitmapSize = bitmap[k].size();
+        if (bitmapSpectra[k].empty()) {
+            computeBitmapSpectrum(k);
+        }
+        if (bitmapSize.width <= thumbnailSize.width && bitmapSize.height <= thumbnailSize.height) {
+            cv::mulSpectrums(thumbnailSpectrum, bitmapSpectra[k], spectrumProduct, 0, true);
+        } else {
+            cv::mulSpectrums(bitmapSpectra[k], thumbnailSpectrum, spectrumProduct, 0, true);
+        }
+        cv::dft(spectrumProduct, correlation, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+        int resultCols = std::abs(thumbnailSize.width - bitmapSize.width) + 1;
+        int resultRows = std::abs(thumbnailSize.height - bitmapSize.height) + 1;
+        result = correlation(cv::Rect(0, 0, resultCols, resultRows));
+    }
+
+    double BitmapPatternDetector::getCorrelationCoefficient(int k, const cv::Point& location, double correlation) {
+        // the correlation is computed with the means of the whole images, 
+        // which gives the same value as with the mean of the window
+        const cv::Mat& thumbnail = bitmapThumbnail.thumbnail;
+        cv::Mat window, templ;
+        if (bitmap[k].rows <= thumbnail.rows && bitmap[k].cols <= thumbnail.cols) {
+            window = thumbnail(cv::Rect(location.x, location.y, bitmap[k].cols, bitmap[k].rows));
+            templ = bitmap[k];
+        } else {
+            window = bitmap[k](cv::Rect(location.x, location.y, thumbnail.cols, thumbnail.rows));
+            templ = thumbnail;
+        }
+        cv::Scalar windowMean, windowDeviation, templMean, templDeviation;
+        cv::meanStdDev(window, windowMean, windowDeviation);
+        cv::meanStdDev(templ, templMean, templDeviation);
+        double norm = windowDeviation[0] * templDeviation[0] * templ.total();
+        if (norm > 0) {
+            return correlation / norm;
+        } else {
+            return 0.0;
+        }
+    }
+
     void BitmapPatternDetector::computeAbsolutePose() {
+        std::vector<int> candidates(bitmap.size());
+        for (int k = 0; k < bitmap.size(); k++) {
+            candidates[k] = k;
+        }
+        computeAbsolutePose(candidates);
+    }
+
+    void BitmapPatternDetector::computeAbsolutePose(const std::vector<int>& candidates) {
+        // the bitmap spectra are computed once for a DFT size larger than the 
+        // thumbnail and the bitmaps, only the thumbnail is transformed per frame
+        const cv::Mat& thumbnail = bitmapThumbnail.thumbnail;
+        int requiredSize = std::max(thumbnail.rows, thumbnail.cols);
+        for (int k : candidates) {
+            requiredSize = std::max(requiredSize, std::max(bitmap[k].rows, bitmap[k].cols));
+        }
+        if (requiredSize > dftSize || 2 * requiredSize < dftSize) {
+            resetBitmapSpectra(cv::getOptimalDFTSize(requiredSize + requiredSize / 8));
+        } else if (bitmapSpectra.size() < bitmap.size()) {
+            bitmapSpectra.resize(bitmap.size());
+        }
+        paddedThumbnail.setTo(0);
+        cv::Mat roi = paddedThumbnail(cv::Rect(0, 0, thumbnail.cols, thumbnail.rows));
+        thumbnail.convertTo(roi, CV_32F);
+        roi -= cv::mean(roi);
+        cv::dft(paddedThumbnail, thumbnailSpectrum, 0, thumbnail.rows);
+
         double maxmaxVal = -1;
+        cv::Point maxmaxLoc;
         bitmapIndex = -1;
-        for (int k = 0; k < bitmap.size(); k++) {
+        for (int k : candidates) {
             int angle = (k%4) * 90;
             cv::Mat result;
             //SHOW(bitmapThumbnail.thumbnail);
             //SHOW(bitmap[k]);
             //cv::waitKey(0);
-            cv::matchTemplate(bitmapThumbnail.thumbnail, bitmap[k], result, cv::TM_CCOEFF);
+            bool bitmapInside = bitmap[k].rows <= thumbnail.rows && bitmap[k].cols <= thumbnail.cols;
+            bool thumbnailInside = bitmap[k].rows >= thumbnail.rows && bitmap[k].cols >= thumbnail.cols;
+            if (bitmapInside || thumbnailInside) {
+                matchBitmap(k, result);
+            } else {
+                cv::matchTemplate(thumbnail, bitmap[k], result, cv::TM_CCOEFF);
+            }
 
             double maxVal;
             cv::Point maxLoc;
@@ -68,6 +164,7 @@ namespace vernier {
 
             if (maxVal > maxmaxVal) {
                 maxmaxVal = maxVal;
+                maxmaxLoc = maxLoc;
                 bitmapIndex = k;
                 maxAngle = angle;
                 periodShift1 = -(maxLoc.x - result.cols / 2) / 2;
@@ -80,6 +177,11 @@ namespace vernier {
             //            cv::imshow("Result", result);
             //            cv::waitKey(0);
         }
+        if (bitmapIndex >= 0) {
+            bitmapCorrelation = getCorrelationCoefficient(bitmapIndex, maxmaxLoc, maxmaxVal);
+        } else {
+            bitmapCorrelation = 0.0;
+        }
 
         if (maxAngle == 90) {
             std::swap(plane1, plane2);
@@ -115,6 +217,8 @@ namespace vernier {
             return periodShift1;
         } else if (attribute == "periodShift2") {
             return periodShift2;
+        } else if (attribute == "bitmapIndex") {
+            return bitmapIndex;
         } else {
             return PeriodicPatternDetector::getInt(attribute);
         }
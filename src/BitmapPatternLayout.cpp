@@ -14,12 +14,14 @@ namespace vernier {
 
     BitmapPatternLayout::BitmapPatternLayout(double period, int nRows, int nCols) : PeriodicPatternLayout() {
         classname = "BitmapPattern";
+        mergeDots = false;
         resize(period, nRows, nCols);
     }
 
     BitmapPatternLayout::BitmapPatternLayout(std::string filename, double period) {
         classname = "BitmapPattern";
         description = "Layout created from " + filename;
+        mergeDots = false;
         cv::Mat image1 = cv::imread(filename, cv::IMREAD_GRAYSCALE), image;
         image1.convertTo(image, CV_32F);
         cv::normalize(image, image, 1.0, 0, cv::NORM_MINMAX);
@@ -98,15 +100,64 @@ namespace vernier {
         }
     }
 
-    void BitmapPatternLayout::toRectangleVector(std::vector<Rectangle>& rectangleList) {
-        for (int col = 0; col < bitmap.cols(); col++) {
-            double x = col * dotSize;
-            for (int row = 0; row < bitmap.rows(); row++) {
-                double y = row * dotSize;
-                if (bitmap(row, col)) {
-                    rectangleList.push_back(Rectangle(x, y, dotSize, dotSize));
+    void BitmapPatternLayout::visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) {
+        visitBitmap(visitor, region, dotSize);
+    }
+
+    void BitmapPatternLayout::visitBitmap(const RectangleVisitor & visitor, const Rectangle & region, double pitch) {
+        int colStart, colStop, rowStart, rowStop;
+        getGridRange(region.x, region.width, 0.0, pitch, bitmap.cols(), colStart, colStop);
+        getGridRange(region.y, region.height, 0.0, pitch, bitmap.rows(), rowStart, rowStop);
+
+        if (!mergeDots || dotSize < pitch) {
+            for (int col = colStart; col < colStop; col++) {
+                double x = col * pitch;
+                for (int row = rowStart; row < rowStop; row++) {
+                    double y = row * pitch;
+                    if (bitmap(row, col)) {
+                        visitor(Rectangle(x, y, dotSize, dotSize));
+                    }
                 }
             }
+            return;
+        }
+
+        // the runs [start, stop) of the previous rows are kept open (sorted by 
+        // start) while the same run is found in the next row, and are visited
+        // as a single rectangle when they are closed
+        struct Run {
+            int start, stop, firstRow;
+        };
+        std::vector<Run> openRuns, runs;
+        for (int row = rowStart; row <= rowStop; row++) {
+            runs.clear();
+            size_t open = 0;
+            int col = colStart;
+            while (row < rowStop && col < colStop) {
+                if (!bitmap(row, col)) {
+                    col++;
+                    continue;
+                }
+                Run run = {col, col, row};
+                while (run.stop < colStop && bitmap(row, run.stop)) {
+                    run.stop++;
+                }
+                col = run.stop;
+                while (open < openRuns.size() && openRuns[open].start <= run.start) {
+                    const Run & previous = openRuns[open++];
+                    if (previous.start == run.start && previous.stop == run.stop) {
+                        run.firstRow = previous.firstRow;
+                        break;
+                    }
+                    visitor(Rectangle(previous.start * pitch, previous.firstRow * pitch, (previous.stop - previous.start - 1) * pitch + dotSize, (row - previous.firstRow - 1) * pitch + dotSize));
+                }
+                runs.push_back(run);
+            }
+            for (; open < openRuns.size(); open++) {
+                const Run & previous = openRuns[open];
+                visitor(Rectangle(previous.start * pitch, previous.firstRow * pitch, (previous.stop - previous.start - 1) * pitch + dotSize, (row - previous.firstRow - 1) * pitch + dotSize));
+            }
+            std::swap(openRuns, runs);
         }
     }
 
@@ -121,6 +172,12 @@ namespace vernier {
             return bitmap(row, col); //* periodicIntensity; 
         }
     }
+
+    void BitmapPatternLayout::getIntensities(const double * x, const double * y, double * intensities, int count) {
+        for (int i = 0; i < count; i++) {
+            intensities[i] = BitmapPatternLayout::getIntensity(x[i], y[i]);
+        }
+    }
     
 //    void BitmapPatternLayout::saveToPNG(std::string filename) {
 //        cv::Mat image(bitmap.rows(), bitmap.cols(), CV_8U);
@@ -161,4 +218,20 @@ namespace vernier {
         return n;
     }
 
+    bool BitmapPatternLayout::getBool(const std::string & attribute) {
+        if (attribute == "mergeDots") {
+            return mergeDots;
+        } else {
+            return PeriodicPatternLayout::getBool(attribute);
+        }
+    }
+
+    void BitmapPatternLayout::setBool(const std::string & attribute, bool value) {
+        if (attribute == "mergeDots") {
+            mergeDots = value;
+        } else {
+            PeriodicPatternLayout::setBool(attribute, value);
+        }
+    }
+
 }
\ No newline at end of file
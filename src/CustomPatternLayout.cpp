@@ -11,6 +11,7 @@ namespace vernier {
 
     CustomPatternLayout::CustomPatternLayout() : PatternLayout() {
         classname = "CustomPattern";
+        buildGrid();
     }
 
     void CustomPatternLayout::resize() {
@@ -24,6 +25,25 @@ namespace vernier {
                 height = dots[i].y + dots[i].height;
             }
         }
+        buildGrid();
+    }
+
+    void CustomPatternLayout::buildGrid() {
+        // the intensity of a dot is not null in [x - 0.5 w, x + 1.5 w] x [y - 0.5 h, y + 1.5 h]
+        std::vector<Rectangle> areas(dots.size());
+        double meanSize = 0.0;
+        for (int i = 0; i < dots.size(); i++) {
+            areas[i] = Rectangle(dots[i].x - 0.5 * dots[i].width, dots[i].y - 0.5 * dots[i].height, 2 * dots[i].width, 2 * dots[i].height);
+            meanSize += 2 * std::max(dots[i].width, dots[i].height);
+        }
+        if (!dots.empty()) {
+            meanSize /= dots.size();
+        }
+
+        // the cells have the mean size of the areas of influence, but the grid 
+        // is limited to about four cells per dot for sparse layouts (the dots 
+        // of a cell are summed in the same order as in the list of dots)
+        grid.build(areas, meanSize, 4.0);
     }
 
     void CustomPatternLayout::writeJSON(std::ofstream & file) {
@@ -107,13 +127,22 @@ namespace vernier {
         description = "Layout created from " + filename;
     }
 
-    void CustomPatternLayout::toRectangleVector(std::vector<Rectangle>& rectangleList) {
-        rectangleList = dots;
+    void CustomPatternLayout::visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) {
+        for (int i = 0; i < dots.size(); i++) {
+            if (region.contains(dots[i].x, dots[i].y)) {
+                visitor(dots[i]);
+            }
+        }
     }
 
     double CustomPatternLayout::getIntensity(double x, double y) {
+        int cell = grid.getCell(x, y);
+        if (cell < 0) {
+            return 0.0;
+        }
         double intensity = 0.0;
-        for (int i = 0; i < dots.size(); i++) {
+        for (int k = grid.cellStarts[cell]; k < grid.cellStarts[cell + 1]; k++) {
+            int i = grid.cellItems[k];
             if (x >= dots[i].x - 0.5 * dots[i].width &&
                     x <= dots[i].x + 1.5 * dots[i].width &&
                     y >= dots[i].y - 0.5 * dots[i].height &&
@@ -125,6 +154,12 @@ namespace vernier {
         return intensity;
     }
 
+    void CustomPatternLayout::getIntensities(const double * x, const double * y, double * intensities, int count) {
+        for (int i = 0; i < count; i++) {
+            intensities[i] = CustomPatternLayout::getIntensity(x[i], y[i]);
+        }
+    }
+
     double CustomPatternLayout::getPhase1(double x, double y) {
         throw Exception("getPhase1 is not implemented for " + this->classname);
         return 0.0;
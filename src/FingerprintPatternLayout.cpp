@@ -32,16 +32,8 @@ namespace vernier {
         PeriodicPatternLayout::resize(period, bitmap.rows(), bitmap.cols());
     }
 
-    void FingerprintPatternLayout::toRectangleVector(std::vector<Rectangle>& rectangleList) {
-        for (int col = 0; col < bitmap.cols(); col++) {
-            double x = col * period;
-            for (int row = 0; row < bitmap.rows(); row++) {
-                double y = row * period;
-                if (bitmap(row, col)) {
-                    rectangleList.push_back(Rectangle(x, y, dotSize, dotSize));
-                }
-            }
-        }
+    void FingerprintPatternLayout::visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) {
+        visitBitmap(visitor, region, period);
     }
 
     double FingerprintPatternLayout::getIntensity(double x, double y) {
@@ -58,6 +50,12 @@ namespace vernier {
         }
     }
 
+    void FingerprintPatternLayout::getIntensities(const double * x, const double * y, double * intensities, int count) {
+        for (int i = 0; i < count; i++) {
+            intensities[i] = FingerprintPatternLayout::getIntensity(x[i], y[i]);
+        }
+    }
+
     int FingerprintPatternLayout::numberOfCorrectEdges() {
         int n = 0;
         for (int col = 0; col < bitmap.cols() - 1; col++) {
@@ -20,9 +20,8 @@ namespace vernier {
         this->snapshotSize = snapshotSize;
         this->physicalPeriod = physicalPeriod;
         this->numberHalfPeriods = numberHalfPeriods;
-        snapshot.resize(snapshotSize, snapshotSize);
-        patternPhase.resize(snapshotSize, snapshotSize);
         window = hannWindow(snapshotSize, 1);
+        workers.clear();
     }
 
     void HPCodePatternDetector::readJSON(const rapidjson::Value& document) {
@@ -33,29 +32,25 @@ namespace vernier {
 
         detector.compute(image8U);
 
-        markers.clear();
-        for (int i = 0; i < detector.codes.size(); i++) {
+        int codeCount = detector.codes.size();
+        MarkerWorker::createWorkers(workers, snapshotSize);
+        codeIds.resize(codeCount);
+        codePoses.resize(codeCount);
+        codeFound.assign(codeCount, 0);
 
-            QRCode code = detector.codes[i];
-            
-            int diameter = (int) (2 * code.getRadius());
-            if (snapshot.cols() < diameter) {
-                std::cout << "The HPCode is too large for pose estimation: increase the snapshot size over " << diameter << " pixels." << std::endl;
-            }
-            if (2 * diameter < numberHalfPeriods) {
-                std::cout << "The HPCode is too tiny for pose estimation: increase the picture quality size." << std::endl;
-            }
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < codeCount; i++) {
+
+            QRCode& code = detector.codes[i];
 
             int centerX = (int) code.center.x;
             int centerY = (int) code.center.y;
             
-            takeSnapshot(centerX, centerY, snapshotSize, array, snapshot);
-            patternPhase.compute(snapshot * window);       
-            plane1 = patternPhase.getPlane1();
-            plane2 = patternPhase.getPlane2();
-
-            if (patternPhase.peaksFound()) {
+            MarkerWorker& worker = *workers[MarkerWorker::getThreadIndex()];
+            if (worker.compute(array, centerX, centerY, window)) {
 
+                PhasePlane plane1 = worker.patternPhase.getPlane1();
+                PhasePlane plane2 = worker.patternPhase.getPlane2();
                 double alpha;
                 double dx, dy;
                 double diffAngle = angleInPiPi(plane1.getAngle() - code.getAngle());
@@ -83,14 +78,30 @@ namespace vernier {
                 double x = pixelSize * (xImg * cos(alpha) - yImg * sin(-alpha)) + dx;
                 double y = pixelSize * (xImg * sin(-alpha) + yImg * cos(alpha)) + dy;
 
-                Pose pose = Pose(x, y, alpha, pixelSize);
+                codePoses[i] = Pose(x, y, alpha, pixelSize);
 
                 if (numberHalfPeriods % 4 == 1) {
-                    unsigned long id = readNumber(code, image8U, plane1.getPixelicPeriod() / 2.0);
-                    markers.insert(std::make_pair(id, pose));
+                    codeIds[i] = readNumber(code, image8U, plane1.getPixelicPeriod() / 2.0);
                 } else {
-                    markers.insert(std::make_pair(i, pose));
+                    codeIds[i] = i;
                 }
+                codeFound[i] = 1;
+            }
+        }
+
+        markers.clear();
+        for (int i = 0; i < codeCount; i++) {
+
+            int diameter = (int) (2 * detector.codes[i].getRadius());
+            if (snapshotSize < diameter) {
+                std::cout << "The HPCode is too large for pose estimation: increase the snapshot size over " << diameter << " pixels." << std::endl;
+            }
+            if (2 * diameter < numberHalfPeriods) {
+                std::cout << "The HPCode is too tiny for pose estimation: increase the picture quality size." << std::endl;
+            }
+
+            if (codeFound[i]) {
+                markers.insert(std::make_pair(codeIds[i], codePoses[i]));
             }
         }
     }
@@ -174,7 +185,7 @@ namespace vernier {
     void HPCodePatternDetector::draw(cv::Mat & image) {
         PatternDetector::draw(image);
         for (std::map<int, Pose>::iterator it = markers.begin(); it != markers.end(); it++) {
-            double length = 2 * patternPhase.getPlane1().getPixelicPeriod() * this->numberHalfPeriods / 4;
+            double length = 2 * physicalPeriod / it->second.pixelSize * this->numberHalfPeriods / 4;
             it->second.draw(image, length, to_string(it->first));
         }
     }
@@ -190,9 +201,29 @@ namespace vernier {
     void HPCodePatternDetector::showControlImages() {
         detector.showControlImages();
         //cv::imshow("Canny image", detector.fiducialDetector.cannyImage);
-        patternPhase.showControlImages();
-        //cv::imshow("Found peaks (red = dir 1, green = dir 2)", patternPhase.getPeaksImage());
-        arrayShow("Snapshot image", snapshot);
+        if (!workers.empty()) {
+            workers[0]->patternPhase.showControlImages();
+            //cv::imshow("Found peaks (red = dir 1, green = dir 2)", patternPhase.getPeaksImage());
+            cv::imshow("Snapshot image", workers[0]->patternPhase.getImage());
+        }
+    }
+
+    void HPCodePatternDetector::setBool(const std::string & attribute, bool value) {
+        if (attribute == "trackingMode") {
+            detector.setTrackingMode(value);
+        } else {
+            PeriodicPatternDetector::setBool(attribute, value);
+        }
+    }
+
+    bool HPCodePatternDetector::getBool(const std::string & attribute) {
+        if (attribute == "trackingMode") {
+            return detector.tracker.trackingMode;
+        } else if (attribute == "tracked") {
+            return detector.isTracked();
+        } else {
+            return PeriodicPatternDetector::getBool(attribute);
+        }
     }
 
 }
\ No newline at end of file
@@ -64,8 +64,9 @@ namespace vernier {
         rectangleList.push_back(Rectangle((2 * row + 4) * dotSize, (2 * col + 3) * dotSize, dotSize, dotSize));
     }
 
-    void HPCodePatternLayout::toRectangleVector(std::vector<Rectangle>& rectangleList) {
-        PeriodicPatternLayout::toRectangleVector(rectangleList);
+    void HPCodePatternLayout::visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) {
+        PeriodicPatternLayout::visitRectangles(visitor, region);
+        std::vector<Rectangle> rectangleList;
         if (nRows > 4) {
             addMarker(0, 0, rectangleList);
         }
@@ -73,6 +74,11 @@ namespace vernier {
             addMarker(nRows - 4, 0, rectangleList);
             addMarker(0, nCols - 4, rectangleList);
         }
+        for (int i = 0; i < rectangleList.size(); i++) {
+            if (region.contains(rectangleList[i].x, rectangleList[i].y)) {
+                visitor(rectangleList[i]);
+            }
+        }
     }
 
     double HPCodePatternLayout::getIntensity(double x, double y) {
@@ -97,6 +103,12 @@ namespace vernier {
             }
         }
     }
+
+    void HPCodePatternLayout::getIntensities(const double * x, const double * y, double * intensities, int count) {
+        for (int i = 0; i < count; i++) {
+            intensities[i] = HPCodePatternLayout::getIntensity(x[i], y[i]);
+        }
+    }
     
     std::string HPCodePatternLayout::toString() {
         return to_string(nRows) + "x" + to_string(nRows) + " " + PeriodicPatternLayout::toString();
@@ -0,0 +1,85 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#include "MarkerTracker.hpp"
+
+namespace vernier {
+
+    MarkerTracker::MarkerTracker() {
+        trackingMode = false;
+        margin = 1.0;
+        fullSearchPeriod = 10;
+        reset();
+    }
+
+    void MarkerTracker::reset() {
+        centers.clear();
+        radii.clear();
+        framesSinceFullSearch = 0;
+    }
+
+    std::vector<cv::Rect> MarkerTracker::getRegions(cv::Size imageSize) {
+        std::vector<cv::Rect> regions;
+        if (!trackingMode || centers.empty() || framesSinceFullSearch + 1 >= fullSearchPeriod) {
+            return regions;
+        }
+
+        cv::Rect frame(0, 0, imageSize.width, imageSize.height);
+        for (int i = 0; i < centers.size(); i++) {
+            double halfSize = radii[i] * (1.0 + margin);
+            int x0 = (int) std::floor(centers[i].x - halfSize);
+            int y0 = (int) std::floor(centers[i].y - halfSize);
+            int x1 = (int) std::ceil(centers[i].x + halfSize);
+            int y1 = (int) std::ceil(centers[i].y + halfSize);
+            cv::Rect region = cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1) & frame;
+            if (region.area() > 0) {
+                regions.push_back(region);
+            }
+        }
+
+        // merging the overlapping regions so that a marker is found only once
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (int i = 0; i < regions.size() && !merged; i++) {
+                for (int j = i + 1; j < regions.size() && !merged; j++) {
+                    if ((regions[i] & regions[j]).area() > 0) {
+                        regions[i] |= regions[j];
+                        regions.erase(regions.begin() + j);
+                        merged = true;
+                    }
+                }
+            }
+        }
+        return regions;
+    }
+
+    bool MarkerTracker::update(const std::vector<cv::Point2d>& centers, const std::vector<double>& radii, bool fullSearch) {
+        ASSERT(centers.size() == radii.size());
+        if (!fullSearch) {
+            // each previous marker must be found again within its radius, a
+            // spurious marker cannot replace a lost one
+            for (int i = 0; i < this->centers.size(); i++) {
+                bool matched = false;
+                for (int j = 0; j < centers.size() && !matched; j++) {
+                    matched = cv::norm(centers[j] - this->centers[i]) <= this->radii[i];
+                }
+                if (!matched) {
+                    return false;
+                }
+            }
+        }
+        this->centers = centers;
+        this->radii = radii;
+        if (fullSearch) {
+            framesSinceFullSearch = 0;
+        } else {
+            framesSinceFullSearch++;
+        }
+        return true;
+    }
+
+}
\ No newline at end of file
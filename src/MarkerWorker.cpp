@@ -0,0 +1,54 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#include "MarkerWorker.hpp"
+#include "Spatial.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace vernier {
+
+    MarkerWorker::MarkerWorker(int snapshotSize) {
+        snapshot.resize(snapshotSize, snapshotSize);
+        patternPhase.resize(snapshotSize, snapshotSize);
+    }
+
+    bool MarkerWorker::compute(const Eigen::ArrayXXd& array, int x, int y, const Eigen::ArrayXXd& window) {
+        patternPhase.compute(array, x, y, window);
+        return patternPhase.peaksFound();
+    }
+
+    void MarkerWorker::takeSnapshot(const Eigen::ArrayXXd& array, int x, int y) {
+        vernier::takeSnapshot(x, y, snapshot.cols(), array, snapshot);
+    }
+
+    int MarkerWorker::getThreadCount() {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    int MarkerWorker::getThreadIndex() {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    void MarkerWorker::createWorkers(std::vector<std::shared_ptr<MarkerWorker> >& workers, int snapshotSize) {
+        if (!workers.empty() && workers[0]->snapshot.cols() != snapshotSize) {
+            workers.clear();
+        }
+        while (workers.size() < getThreadCount()) {
+            workers.push_back(std::make_shared<MarkerWorker>(snapshotSize));
+        }
+    }
+
+}
\ No newline at end of file
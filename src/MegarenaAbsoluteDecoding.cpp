@@ -9,12 +9,18 @@
 namespace vernier {
 
     MegarenaAbsoluteDecoding::MegarenaAbsoluteDecoding() {
+        sequenceLength = 0;
+        windowWidth = 0;
     }
 
     MegarenaAbsoluteDecoding::MegarenaAbsoluteDecoding(Eigen::ArrayXXi& bitSequence) {
         resize(bitSequence);
     }
 
+    MegarenaAbsoluteDecoding::MegarenaAbsoluteDecoding(const MegarenaPackedSequence& bitSequence) {
+        resize(bitSequence);
+    }
+
     void MegarenaAbsoluteDecoding::resize(Eigen::ArrayXXi& bitSequence) {
         for (int i = 0; i < bitSequence.cols(); i++) {
             if (bitSequence(0, i) == 0) {
@@ -24,7 +30,47 @@ namespace vernier {
                 bitSequence(0, i) = 0;
             }
         }
-        this->bitSequence = bitSequence;
+        // only the bits in the middle of each triplet are coding
+        sequenceLength = bitSequence.cols();
+        codeBits.resize((sequenceLength + 1) / 3);
+        for (int k = 0; k < codeBits.size(); k++) {
+            codeBits.set(k, bitSequence(0, 3 * k + 1) > 0);
+        }
+        buildWindowTable();
+    }
+
+    void MegarenaAbsoluteDecoding::resize(const MegarenaPackedSequence& bitSequence) {
+        sequenceLength = bitSequence.size();
+        bitSequence.decimate(1, 3, codeBits);
+        buildWindowTable();
+    }
+
+    void MegarenaAbsoluteDecoding::buildWindowTable() {
+        windowWidth = 0;
+        windowPositions.clear();
+        if (codeBits.size() < 2) {
+            return;
+        }
+
+        // for a megarena sequence of depth n, every window of n bits is unique
+        int width = (int) std::round(std::log2(codeBits.size()));
+        if (width < 1 || width > 24) {
+            return;
+        }
+        windowPositions.assign((size_t) 1 << width, -1);
+        int windowMask = (1 << width) - 1;
+        int window = 0;
+        for (int k = 0; k < codeBits.size(); k++) {
+            window = ((window << 1) | (int) codeBits.get(k)) & windowMask;
+            if (k >= width - 1) {
+                if (windowPositions[window] >= 0) {
+                    windowPositions.clear();
+                    return;
+                }
+                windowPositions[window] = k;
+            }
+        }
+        windowWidth = width;
     }
 
     Eigen::ArrayXXd MegarenaAbsoluteDecoding::getCodeSequence(Eigen::ArrayXXd numberWhiteDots, Eigen::ArrayXXd cumulWhiteDots, Eigen::ArrayXXd numberBackgroundDots, Eigen::ArrayXXd cumulBackgroundDots, Eigen::VectorXd& codeOrientation) {
@@ -153,7 +199,6 @@ namespace vernier {
     }
 
     int MegarenaAbsoluteDecoding::findCodePosition(Eigen::ArrayXXd& codeSample, int MSB) {
-        double maximum;
         int offset = floor(codeSample.rows() / 2);
         int direction = 1;
 
@@ -162,34 +207,76 @@ namespace vernier {
             direction = -1;
         }
 
-        //bitSequence = bitSequence.block(0, 0, 1, 100);
-
-        // convolution with 'same' mode
-        Eigen::ArrayXXd testPeak(1, bitSequence.cols());
-        for (int i = 0; i < bitSequence.cols(); i++) {
-            int jMin;
-            int jMax;
-            if (i >= offset) {
-                jMin = 0;
-            } else {
-                jMin = offset - i;
+        // packing of the hard decisions of the sample, split according to the sample index modulo 3
+        for (int residue = 0; residue < 3; residue++) {
+            int length = (codeSample.rows() > residue) ? (codeSample.rows() - residue + 2) / 3 : 0;
+            sampleBits[residue].resize(length);
+            sampleMask[residue].resize(length);
+        }
+        for (int j = 0; j < codeSample.rows(); j++) {
+            if (codeSample(j, 0) != 0) {
+                sampleMask[j % 3].set(j / 3, true);
+                sampleBits[j % 3].set(j / 3, codeSample(j, 0) > 0);
             }
+        }
 
-            if (i + offset < bitSequence.cols()) {
-                jMax = codeSample.rows() - 1;
-            } else {
-                jMax = bitSequence.cols() - 1 - i + offset;
+        // correlation with 'same' mode: for a shift i, the sample index j is 
+        // compared to the sequence index i - offset + j which is coding only if 
+        // it equals 1 modulo 3
+        int maximum = 0;
+        int maxCol = -1;
+
+        if (windowWidth > 0) {
+            int windowMask = (1 << windowWidth) - 1;
+            for (int residue = 0; residue < 3; residue++) {
+                int window = 0;
+                int validCount = 0;
+                int lastCodePosition = sequenceLength;
+                for (int m = 0; m < sampleBits[residue].size(); m++) {
+                    if (sampleMask[residue].get(m)) {
+                        window = ((window << 1) | (int) sampleBits[residue].get(m)) & windowMask;
+                        validCount++;
+                    } else {
+                        validCount = 0;
+                    }
+                    if (validCount >= windowWidth && windowPositions[window] >= 0) {
+                        int codePosition = windowPositions[window] - m;
+                        int i = 3 * codePosition + 1 + offset - residue;
+                        if (codePosition != lastCodePosition && i >= 0 && i < sequenceLength) {
+                            int value = codeBits.correlate(sampleBits[residue], sampleMask[residue], codePosition);
+                            if (maxCol < 0 || value > maximum || (value == maximum && i < maxCol)) {
+                                maximum = value;
+                                maxCol = i;
+                            }
+                        }
+                        lastCodePosition = codePosition;
+                    }
+                }
             }
+        }
 
-            testPeak(0, i) = 0;
-            for (int j = jMin; j <= jMax; j++) {
-                testPeak(0, i) += (double) bitSequence(0, i - offset + j) * codeSample(j, 0);
+        // the best candidate is kept only if it explains the sample with few errors 
+        // (1/16 of the bits at most), otherwise the whole sequence is scanned
+        if (maxCol >= 0) {
+            int residue = ((1 - maxCol + offset) % 3 + 3) % 3;
+            int validCount = sampleMask[residue].count();
+            int errorCount = (validCount - maximum) / 2;
+            if (16 * errorCount > validCount) {
+                maxCol = -1;
             }
         }
 
-        Eigen::MatrixXd::Index maxRow, maxCol;
-
-        maximum = testPeak.maxCoeff(&maxRow, &maxCol);
+        if (maxCol < 0) {
+            for (int i = 0; i < sequenceLength; i++) {
+                int residue = ((1 - i + offset) % 3 + 3) % 3;
+                int codePosition = (i - offset + residue - 1) / 3;
+                int value = codeBits.correlate(sampleBits[residue], sampleMask[residue], codePosition);
+                if (i == 0 || value > maximum) {
+                    maximum = value;
+                    maxCol = i;
+                }
+            }
+        }
 
         return direction * maxCol;
     }
@@ -10,32 +10,39 @@
 
 namespace vernier {
 
-    int MegarenaBitSequence::getBit(int state, int bitPosition) {
-        return (state >> bitPosition) & 1;
+    // Feedback taps of maximal-length shift registers (primitive polynomials), 
+    // indexed by code depth: bit p of the mask means that bit p of the state 
+    // is added (modulo 2) to compute the next bit
+    static const int feedbackTaps[MegarenaBitSequence::MAX_CODE_DEPTH + 1] = {
+        0, 0, 0, 0,
+        0x9, // 4: x^4 + x^3 + 1
+        0x12, // 5
+        0x21, // 6
+        0x44, // 7
+        0xC3, // 8
+        0x108, // 9
+        0x240, // 10
+        0x402, // 11
+        0x883, // 12
+        0x100D, // 13
+        0x2015, // 14
+        0x6000, // 15
+        0xD008, // 16
+        0x12000, // 17
+        0x20400, // 18
+        0x40023, // 19
+        0x90000 // 20
+    };
+
+    bool MegarenaBitSequence::isValidCodeDepth(int codeDepth) {
+        return codeDepth >= MIN_CODE_DEPTH && codeDepth <= MAX_CODE_DEPTH;
     }
 
     int MegarenaBitSequence::nextBit(int codeDepth, int state) {
-        if (codeDepth == 4) {
-            return (getBit(state, 0) + getBit(state, 3)) % 2;
-        } else if (codeDepth == 5) {
-            return (getBit(state, 1) + getBit(state, 4)) % 2;
-        } else if (codeDepth == 6) {
-            return (getBit(state, 0) + getBit(state, 5)) % 2;
-        } else if (codeDepth == 7) {
-            return (getBit(state, 2) + getBit(state, 6)) % 2;
-        } else if (codeDepth == 8) {
-            return (getBit(state, 0) + getBit(state, 1) + getBit(state, 6) + getBit(state, 7)) % 2;
-        } else if (codeDepth == 9) {
-            return (getBit(state, 3) + getBit(state, 8)) % 2;
-        } else if (codeDepth == 10) {
-            return (getBit(state, 6) + getBit(state, 9)) % 2;
-        } else if (codeDepth == 11) {
-            return (getBit(state, 1) + getBit(state, 10)) % 2;
-        } else if (codeDepth == 12) {
-            return (getBit(state, 0) + getBit(state, 1) + getBit(state, 7) + getBit(state, 11)) % 2;
-        } else {
-            throw Exception("The megarena code depth must between 4 and 12.");
+        if (!isValidCodeDepth(codeDepth)) {
+            throw Exception("The megarena code depth must between " + to_string(MIN_CODE_DEPTH) + " and " + to_string(MAX_CODE_DEPTH) + ".");
         }
+        return popcount64(state & feedbackTaps[codeDepth]) % 2;
     }
     
     int MegarenaBitSequence::codeDepth(int sequenceLength) {
@@ -43,6 +50,9 @@ namespace vernier {
     }
 
     void MegarenaBitSequence::generate(int codeDepth, Eigen::ArrayXXi & sequence) {
+        if (!isValidCodeDepth(codeDepth)) {
+            throw Exception("The megarena code depth must between " + to_string(MIN_CODE_DEPTH) + " and " + to_string(MAX_CODE_DEPTH) + ".");
+        }
         int codeMax = 1 << codeDepth; // 2^codeDepth
         int codeCount = codeMax - 1;
 
@@ -61,6 +71,23 @@ namespace vernier {
         }
     }
 
+    void MegarenaBitSequence::generate(int codeDepth, MegarenaPackedSequence & sequence) {
+        if (!isValidCodeDepth(codeDepth)) {
+            throw Exception("The megarena code depth must between " + to_string(MIN_CODE_DEPTH) + " and " + to_string(MAX_CODE_DEPTH) + ".");
+        }
+        int codeMax = 1 << codeDepth; // 2^codeDepth
+        int codeCount = codeMax - 1;
+
+        sequence.resize(3 * (codeCount + codeDepth - 1));
+        sequence.fill();
+        int state = codeCount;
+        for (int index = 1; index < codeCount - 1; index++) {
+            int bit = nextBit(codeDepth, state);
+            state = (state * 2) % codeMax + bit;
+            sequence.set(3 * (index + codeDepth - 1) + 1, bit);
+        }
+    }
+
     bool MegarenaBitSequence::check(int codeDepth, Eigen::ArrayXXi & bs) {
         int codeMax = 1 << codeDepth; // 2^codeDepth
         int codeCount = codeMax - 1;
@@ -9,12 +9,13 @@
 namespace vernier {
 
     MegarenaCell::MegarenaCell() {
+        codeOrientation.setZero(5);
     }
 
     void MegarenaCell::resize() {
     }
 
-    void MegarenaCell::getGlobalCell(Eigen::ArrayXXd thumbnailNumberWhiteDots, Eigen::ArrayXXd thumbnailCumulWhiteDots) {
+    void MegarenaCell::getGlobalCell(const Eigen::ArrayXXd& thumbnailNumberWhiteDots, const Eigen::ArrayXXd& thumbnailCumulWhiteDots) {
         Eigen::Array33d sumOnlyDotsRemain = Eigen::Array33d::Zero(3, 3);
         Eigen::Array33d countOnlyDots = Eigen::Array33d::Zero(3, 3);
 
@@ -33,7 +34,11 @@ namespace vernier {
         this->globalCell = sumOnlyDotsRemain;
     }
 
-    Eigen::VectorXd MegarenaCell::getCodeOrientation() {
+    void MegarenaCell::setGlobalCell(const Eigen::Array33d& numberWhiteDots, const Eigen::Array33d& cumulWhiteDots) {
+        this->globalCell = cumulWhiteDots / numberWhiteDots;
+    }
+
+    const Eigen::VectorXd& MegarenaCell::getCodeOrientation() {
         Eigen::Matrix<Eigen::Array33d, 3, 3> orientation1;
         Eigen::Matrix<Eigen::Array33d, 3, 3> orientation2;
         Eigen::Matrix<Eigen::Array33d, 3, 3> orientation3;
@@ -253,13 +258,11 @@ namespace vernier {
             }
         }
 
-        Eigen::VectorXd codingLines(5);
-        codingLines << coding1, coding2, missing1, missing2, quadrant;
-        this->codeOrientation = codingLines;
+        codeOrientation << coding1, coding2, missing1, missing2, quadrant;
 
         //guiDisplayCell();
 
-        return codingLines;
+        return codeOrientation;
     }
 
     Eigen::Array33d MegarenaCell::getGlobalCellOut() {
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#include "MegarenaPackedSequence.hpp"
+
+namespace vernier {
+
+    MegarenaPackedSequence::MegarenaPackedSequence() {
+        length = 0;
+    }
+
+    MegarenaPackedSequence::MegarenaPackedSequence(const Eigen::ArrayXXi & sequence) {
+        length = 0;
+        resize(sequence.size());
+        for (int i = 0; i < length; i++) {
+            if (sequence(i) != 0) {
+                set(i, true);
+            }
+        }
+    }
+
+    void MegarenaPackedSequence::resize(int length) {
+        if (length < 0) {
+            throw Exception("The length of a bit sequence must be positive.");
+        }
+        this->length = length;
+        words.assign((length + 63) / 64, 0);
+    }
+
+    void MegarenaPackedSequence::clear() {
+        std::fill(words.begin(), words.end(), 0);
+    }
+
+    void MegarenaPackedSequence::fill() {
+        std::fill(words.begin(), words.end(), ~(uint64_t) 0);
+        if (length % 64 != 0) {
+            // the bits after the end of the sequence are kept to 0
+            words.back() = ((uint64_t) 1 << (length % 64)) - 1;
+        }
+    }
+
+    uint64_t MegarenaPackedSequence::getWord(int position) const {
+        if (position >= length || position <= -64) {
+            return 0;
+        }
+        if (position < 0) {
+            return getWord(0) << (-position);
+        }
+        int index = position >> 6;
+        int shift = position & 63;
+        uint64_t word = words[index] >> shift;
+        if (shift != 0 && index + 1 < (int) words.size()) {
+            word |= words[index + 1] << (64 - shift);
+        }
+        return word;
+    }
+
+    uint64_t MegarenaPackedSequence::getRangeMask(int position) const {
+        int low = std::max(0, -position);
+        int high = std::min(64, length - position);
+        if (high <= low) {
+            return 0;
+        }
+        uint64_t mask = (high == 64) ? ~(uint64_t) 0 : ((uint64_t) 1 << high) - 1;
+        return mask & ~(((uint64_t) 1 << low) - 1);
+    }
+
+    int MegarenaPackedSequence::count() const {
+        int sum = 0;
+        for (size_t i = 0; i < words.size(); i++) {
+            sum += popcount64(words[i]);
+        }
+        return sum;
+    }
+
+    void MegarenaPackedSequence::decimate(int start, int step, MegarenaPackedSequence & output) const {
+        if (step <= 0) {
+            throw Exception("The decimation step must be positive.");
+        }
+        int outputLength = (start < length) ? (length - start + step - 1) / step : 0;
+        output.resize(outputLength);
+        for (int i = 0; i < outputLength; i++) {
+            if (get(start + i * step)) {
+                output.set(i, true);
+            }
+        }
+    }
+
+    int MegarenaPackedSequence::correlate(const MegarenaPackedSequence & sample, const MegarenaPackedSequence & mask, int position) const {
+        int sum = 0;
+        for (size_t i = 0; i < sample.words.size(); i++) {
+            int wordPosition = position + 64 * (int) i;
+            uint64_t valid = mask.words[i] & getRangeMask(wordPosition);
+            if (valid != 0) {
+                uint64_t disagreement = (getWord(wordPosition) ^ sample.words[i]) & valid;
+                sum += popcount64(valid) - 2 * popcount64(disagreement);
+            }
+        }
+        return sum;
+    }
+
+    Eigen::ArrayXXi MegarenaPackedSequence::toArray() const {
+        Eigen::ArrayXXi sequence(1, length);
+        for (int i = 0; i < length; i++) {
+            sequence(0, i) = get(i);
+        }
+        return sequence;
+    }
+
+}
@@ -11,7 +11,7 @@ namespace vernier {
 
     MegarenaPatternDetector::MegarenaPatternDetector()
     : PeriodicPatternDetector() {
-        classname = "MegarenaPattern";
+        initialize();
     }
 
     MegarenaPatternDetector::MegarenaPatternDetector(double physicalPeriod, Eigen::ArrayXXi bitSequence)
@@ -22,17 +22,27 @@ namespace vernier {
         if (bitSequence.cols() <= 0) {
             throw Exception("The bit sequence must have at least one column.");
         }
-        classname = "MegarenaPattern";
-        this->bitSequence = bitSequence;
-        decoding.resize(bitSequence);
+        initialize();
+        this->bitSequence = MegarenaPackedSequence((bitSequence > 0).cast<int>());
+        decoding.resize(this->bitSequence);
     }
 
     MegarenaPatternDetector::MegarenaPatternDetector(double physicalPeriod, int codeSize)
     : PeriodicPatternDetector(physicalPeriod) {
+        initialize();
         MegarenaBitSequence::generate(codeSize, bitSequence);
-        classname = "MegarenaPattern";
         decoding.resize(bitSequence);
     }
+
+    void MegarenaPatternDetector::initialize() {
+        classname = "MegarenaPattern";
+        orientation = 0;
+        trackingMode = false;
+        tracked = false;
+        previousPoseFound = false;
+        trackingRange = 2;
+        trackingBitCount = 24;
+    }
     
     void MegarenaPatternDetector::readJSON(const rapidjson::Value& document) {
 
@@ -46,22 +56,22 @@ namespace vernier {
         }
 
         if (document.HasMember("bitSequence") && document["bitSequence"].IsArray()) {
-            bitSequence.resize(1, document["bitSequence"].Size());
+            bitSequence.resize(document["bitSequence"].Size());
 
-            for (rapidjson::SizeType row = 0; row < bitSequence.cols(); row++) {
+            for (rapidjson::SizeType row = 0; row < bitSequence.size(); row++) {
                 const rapidjson::Value& value = document["bitSequence"][row];
                 if (value.IsInt()) {
-                    bitSequence(0, row) = value.GetInt();
+                    bitSequence.set(row, value.GetInt() > 0);
                 } else {
                     throw Exception("The file is not a valid bitmap pattern file, the row " + to_string(row) + " of the bitmap has a wrong format");
                 }
             }
         } else if (document.HasMember("codeSize") && document["codeSize"].IsInt()) {
             int codeSize = document["codeSize"].GetInt();
-            if (codeSize >= 4 && codeSize <= 12) {
+            if (MegarenaBitSequence::isValidCodeDepth(codeSize)) {
                 MegarenaBitSequence::generate(codeSize, bitSequence);
             } else {
-                throw Exception("The file is not a valid megarena pattern file, the code size must between 4 and 12.");
+                throw Exception("The file is not a valid megarena pattern file, the code size must between " + to_string(MegarenaBitSequence::MIN_CODE_DEPTH) + " and " + to_string(MegarenaBitSequence::MAX_CODE_DEPTH) + ".");
             }
         } else {
             throw Exception("The file is not a valid bitmap pattern file, the bitmap is missing or has a wrong format.");
@@ -71,8 +81,41 @@ namespace vernier {
     }
 
     void MegarenaPatternDetector::computeImage() {
+        if (previousPoseFound) {
+            previousPlane1 = plane1;
+            previousPlane2 = plane2;
+            previousShift1 = periodShift1;
+            previousShift2 = periodShift2;
+        }
+
         PeriodicPatternDetector::computeImage();
-        computeAbsolutePose();
+
+        tracked = false;
+        if (trackingMode && previousPoseFound && patternFound()) {
+            tracked = trackAbsolutePose();
+        }
+        if (!tracked) {
+            if (windowTracked) {
+                // the thumbnail is built from the phase maps of the whole image
+                computeFullImage();
+                centerTrackingWindow();
+            }
+            computeAbsolutePose();
+        }
+        previousPoseFound = patternFound();
+    }
+
+    void MegarenaPatternDetector::orientPlanes(int orientation, PhasePlane& plane1, PhasePlane& plane2) {
+        if (orientation == 1) {
+            std::swap(plane1, plane2);
+            plane2.flip();
+        } else if (orientation == 2) {
+            std::swap(plane1, plane2);
+            plane1.flip();
+        } else if (orientation == 3) {
+            plane1.flip();
+            plane2.flip();
+        }
     }
 
     void MegarenaPatternDetector::computeAbsolutePose() {
@@ -94,14 +137,16 @@ namespace vernier {
         thumbnail.resize(length1, length2);
         thumbnail.compute(patternPhase.getUnwrappedPhase1(), patternPhase.getUnwrappedPhase2(), array);
 
-        Eigen::ArrayXXd sequence1 = thumbnail.getSequence1();
-        Eigen::ArrayXXd sequence2 = thumbnail.getSequence2();
+        // the samples are copied in members (the decoding reverses them in place)
+        // to reuse their memory from one image to the next
+        codeSample1 = thumbnail.getSequence1();
+        codeSample2 = thumbnail.getSequence2();
 
         int MSB1 = thumbnail.getMSB1();
         int MSB2 = thumbnail.getMSB2();
 
-        periodShift1 = decoding.findCodePosition(sequence1, MSB1);
-        periodShift2 = decoding.findCodePosition(sequence2, MSB2);
+        periodShift1 = decoding.findCodePosition(codeSample1, MSB1);
+        periodShift2 = decoding.findCodePosition(codeSample2, MSB2);
 
         //        plane1Save = plane1;
         //        plane2Save = plane2;
@@ -109,32 +154,193 @@ namespace vernier {
         if (periodShift1 >= 0 && periodShift2 >= 0) {
             // no change	
             //std::cout<<"code1>0 && code2>0"<<std::endl;
+            orientation = 0;
         } else if (periodShift1 < 0 && periodShift2 >= 0) {
             std::swap(periodShift1, periodShift2);
-            std::swap(plane1, plane2);
-            plane2.flip();
             //std::cout<<"code1<0 && code2>0"<<std::endl;
+            orientation = 1;
             thumbnail.rotate270();
             patternPhase.rotate270();
         } else if (periodShift1 >= 0 && periodShift2 < 0) {
             std::swap(periodShift1, periodShift2);
-            std::swap(plane1, plane2);
-            plane1.flip();
             //std::cout<<"code1>0 && code2<0"<<std::endl;
+            orientation = 2;
             thumbnail.rotate90();
             patternPhase.rotate90();
         } else {
-            plane1.flip();
-            plane2.flip();
             //std::cout<<"code1<0 && code2<0"<<std::endl;
+            orientation = 3;
             thumbnail.rotate180();
             patternPhase.rotate180();
         }
+        orientPlanes(orientation, plane1, plane2);
 
         periodShift1 = std::abs(periodShift1);
         periodShift2 = std::abs(periodShift2);
     }
 
+    bool MegarenaPatternDetector::trackAbsolutePose() {
+        // the new planes are oriented as in the previous frame, the rotation 
+        // between two frames must be small enough to keep the same orientation
+        PhasePlane oriented1 = plane1;
+        PhasePlane oriented2 = plane2;
+        orientPlanes(orientation, oriented1, oriented2);
+        if (std::abs(angleInPiPi(oriented1.getAngle() - previousPlane1.getAngle())) > PI / 4
+                || std::abs(angleInPiPi(oriented2.getAngle() - previousPlane2.getAngle())) > PI / 4) {
+            return false;
+        }
+
+        // the position at the image center (in periods) is assumed to be close 
+        // to the previous one, the nearest shifts are tried first
+        int predictedShift1 = (int) std::round(previousShift1 + (previousPlane1.getC() - oriented1.getC()) / (2 * PI));
+        int predictedShift2 = (int) std::round(previousShift2 + (previousPlane2.getC() - oriented2.getC()) / (2 * PI));
+
+        for (int distance = 0; distance <= 2 * trackingRange; distance++) {
+            for (int delta1 = -trackingRange; delta1 <= trackingRange; delta1++) {
+                int delta2 = distance - std::abs(delta1);
+                if (delta2 < 0 || delta2 > trackingRange) {
+                    continue;
+                }
+                for (int sign = -1; sign <= 1; sign += 2) {
+                    if (delta2 == 0 && sign > 0) {
+                        break;
+                    }
+                    if (checkCodeBits(oriented1, oriented2, predictedShift1 + delta1, predictedShift2 + sign * delta2)) {
+                        plane1 = oriented1;
+                        plane2 = oriented2;
+                        periodShift1 = predictedShift1 + delta1;
+                        periodShift2 = predictedShift2 + sign * delta2;
+                        if (orientation == 1) {
+                            patternPhase.rotate270();
+                        } else if (orientation == 2) {
+                            patternPhase.rotate90();
+                        } else if (orientation == 3) {
+                            patternPhase.rotate180();
+                        }
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    bool MegarenaPatternDetector::checkCodeBits(PhasePlane& oriented1, PhasePlane& oriented2, int shift1, int shift2) {
+        int center1 = (int) std::round(shift1 + oriented1.getC() / (2 * PI));
+        int center2 = (int) std::round(shift2 + oriented2.getC() / (2 * PI));
+        int codeDepth = MegarenaBitSequence::codeDepth(bitSequence.size());
+        int maxBitCount = std::max(trackingBitCount, codeDepth);
+
+        // the dots are read on five columns crossing the coding rows (index % 3 == 1) 
+        // nearest to the image center and their two neighbour rows, and conversely
+        // in the other direction
+        dotIntensities.clear();
+        dotExpected.clear();
+        bitSums.clear();
+        bitExpected.clear();
+        int bitCount[2] = {0, 0};
+        int bitErrorCount[2] = {0, 0};
+        for (int direction = 0; direction < 2; direction++) {
+            int center = (direction == 0) ? center1 : center2;
+            int centerOther = (direction == 0) ? center2 : center1;
+            int coding = center - ((center - 1) % 3 + 3) % 3;
+            for (int step = 0; step < 2 * maxBitCount && bitCount[direction] < maxBitCount; step++) {
+                // 0, -3, +3, -6, +6...
+                int code = coding + 3 * ((step + 1) / 2) * ((step % 2 == 0) ? 1 : -1);
+                if (code < 1 || code + 1 >= bitSequence.size()) {
+                    continue;
+                }
+                double bitSum = 0.0;
+                int bitSampleCount = 0;
+                for (int row = code - 1; row <= code + 1; row++) {
+                    for (int other = centerOther - 2; other <= centerOther + 2; other++) {
+                        if (other < 0 || other >= bitSequence.size()) {
+                            continue;
+                        }
+                        double intensity = (direction == 0) ? getDotIntensity(oriented1, oriented2, row - shift1, other - shift2)
+                                : getDotIntensity(oriented1, oriented2, other - shift1, row - shift2);
+                        if (std::isnan(intensity)) {
+                            continue;
+                        }
+                        if (row == code && other % 3 != 1) {
+                            // the dots of a coding row on the always present columns give the code bit
+                            bitSum += intensity;
+                            bitSampleCount++;
+                        } else {
+                            dotIntensities.push_back(intensity);
+                            dotExpected.push_back(bitSequence.get(row) && bitSequence.get(other) && (row % 3 != 0 || other % 3 != 0));
+                        }
+                    }
+                }
+                if (bitSampleCount > 0) {
+                    bitSums.push_back(bitSum / bitSampleCount);
+                    bitExpected.push_back(bitSequence.get(code));
+                    bitCount[direction]++;
+                }
+            }
+            if (bitCount[direction] < codeDepth) {
+                return false;
+            }
+        }
+
+        // threshold between the expected dots and the expected holes
+        double presentSum = 0.0, absentSum = 0.0;
+        int presentCount = 0, absentCount = 0;
+        for (size_t i = 0; i < dotIntensities.size(); i++) {
+            if (dotExpected[i]) {
+                presentSum += dotIntensities[i];
+                presentCount++;
+            } else {
+                absentSum += dotIntensities[i];
+                absentCount++;
+            }
+        }
+        if (presentCount == 0 || absentCount == 0 || presentSum / presentCount <= absentSum / absentCount) {
+            return false;
+        }
+        double threshold = (presentSum / presentCount + absentSum / absentCount) / 2;
+
+        // the non coding dots check the alignment modulo 3 and the code bits check the shifts
+        int dotErrorCount = 0;
+        for (size_t i = 0; i < dotIntensities.size(); i++) {
+            if ((dotIntensities[i] > threshold) != dotExpected[i]) {
+                dotErrorCount++;
+            }
+        }
+        if (16 * dotErrorCount > (int) dotIntensities.size()) {
+            return false;
+        }
+
+        // any codeDepth consecutive bits of the sum of the sequence and a shifted copy
+        // (itself a shifted m-sequence) contain at least one 1, so that a wrong shift 
+        // gives at least k errors on k*codeDepth consecutive bits
+        for (size_t i = 0; i < bitSums.size(); i++) {
+            if ((bitSums[i] > threshold) != bitExpected[i]) {
+                bitErrorCount[(int) i < bitCount[0] ? 0 : 1]++;
+            }
+        }
+        return bitErrorCount[0] < bitCount[0] / codeDepth && bitErrorCount[1] < bitCount[1] / codeDepth;
+    }
+
+    double MegarenaPatternDetector::getDotIntensity(PhasePlane& oriented1, PhasePlane& oriented2, double index1, double index2) {
+        // solves oriented1(x, y) = 2 pi index1 and oriented2(x, y) = 2 pi index2
+        // (the planes are centered on the image)
+        double determinant = oriented1.getA() * oriented2.getB() - oriented1.getB() * oriented2.getA();
+        if (std::abs(determinant) < 1e-12) {
+            return NAN;
+        }
+        double phase1 = 2 * PI * index1 - oriented1.getC();
+        double phase2 = 2 * PI * index2 - oriented2.getC();
+        double x = (phase1 * oriented2.getB() - phase2 * oriented1.getB()) / determinant;
+        double y = (oriented1.getA() * phase2 - oriented2.getA() * phase1) / determinant;
+        int col = (int) std::round(x + array.cols() / 2);
+        int row = (int) std::round(y + array.rows() / 2);
+        if (col < 0 || row < 0 || col >= array.cols() || row >= array.rows()) {
+            return NAN;
+        }
+        return array(row, col);
+    }
+
     MegarenaThumbnail MegarenaPatternDetector::getThumbnail() {
         return thumbnail;
     }
@@ -165,7 +371,32 @@ namespace vernier {
     }
 
     std::string MegarenaPatternDetector::toString() {
-        return PeriodicPatternDetector::toString() + ", codeSize: " + to_string(MegarenaBitSequence::codeDepth(bitSequence.cols())) + "bits";
+        return PeriodicPatternDetector::toString() + ", codeSize: " + to_string(MegarenaBitSequence::codeDepth(bitSequence.size())) + "bits";
+    }
+
+    void MegarenaPatternDetector::setTrackingMode(bool trackingMode) {
+        this->trackingMode = trackingMode;
+        tracked = false;
+    }
+
+    bool MegarenaPatternDetector::isTracked() {
+        return tracked;
+    }
+
+    void MegarenaPatternDetector::setInt(const std::string & attribute, int value) {
+        if (attribute == "trackingRange") {
+            if (value < 0) {
+                throw Exception("The tracking range must be positive.");
+            }
+            trackingRange = value;
+        } else if (attribute == "trackingBitCount") {
+            if (value <= 0) {
+                throw Exception("The number of code bits checked in tracking mode must be positive.");
+            }
+            trackingBitCount = value;
+        } else {
+            PeriodicPatternDetector::setInt(attribute, value);
+        }
     }
 
     int MegarenaPatternDetector::getInt(const std::string & attribute) {
@@ -173,11 +404,33 @@ namespace vernier {
             return periodShift1;
         } else if (attribute == "codePosition2") {
             return periodShift2;
+        } else if (attribute == "trackingRange") {
+            return trackingRange;
+        } else if (attribute == "trackingBitCount") {
+            return trackingBitCount;
         } else {
             return PeriodicPatternDetector::getInt(attribute);
         }
     }
 
+    void MegarenaPatternDetector::setBool(const std::string & attribute, bool value) {
+        if (attribute == "trackingMode") {
+            setTrackingMode(value);
+        } else {
+            PeriodicPatternDetector::setBool(attribute, value);
+        }
+    }
+
+    bool MegarenaPatternDetector::getBool(const std::string & attribute) {
+        if (attribute == "trackingMode") {
+            return trackingMode;
+        } else if (attribute == "tracked") {
+            return tracked;
+        } else {
+            return PeriodicPatternDetector::getBool(attribute);
+        }
+    }
+
     void* MegarenaPatternDetector::getObject(const std::string & attribute) {
         if (attribute == "bitSequence") {
             return &bitSequence;
@@ -17,7 +17,10 @@ namespace vernier {
     MegarenaPatternLayout::MegarenaPatternLayout(double period, Eigen::ArrayXXi & bitSequence)
     : PeriodicPatternLayout() {
         classname = "MegarenaPattern";
-        this->bitSequence = bitSequence;
+        if (bitSequence.rows() != 1) {
+            throw Exception("The bit sequence must have a single row");
+        }
+        this->bitSequence = MegarenaPackedSequence(bitSequence);
         this->codeDepth = MegarenaBitSequence::codeDepth(bitSequence.cols());
         resize(period);
     }
@@ -34,16 +37,13 @@ namespace vernier {
         if (period < 0.0) {
             throw Exception("The period must be positive.");
         }
-        if (bitSequence.rows() != 1) {
-            throw Exception("The bit sequence must have a single row");
-        }
-        if (bitSequence.cols() <= 0) {
+        if (bitSequence.size() <= 0) {
             throw Exception("The bit sequence must have at least one column.");
         }
         this->period = period;
         this->dotSize = 0.5 * period;
-        this->nRows = bitSequence.cols();
-        this->nCols = bitSequence.cols();
+        this->nRows = bitSequence.size();
+        this->nCols = bitSequence.size();
         width = period * nCols - 0.5 * period;
         height = period * nRows - 0.5 * period;
         originX = 0.25 * period;
@@ -57,8 +57,8 @@ namespace vernier {
         file << "        \"period\": " << period << "," << std::endl;
         file << "        \"regionOfInterest\": [" << regionOfInterest.x << ", " << regionOfInterest.y << ", " << regionOfInterest.width << ", " << regionOfInterest.height << " ]," << std::endl;
         //        file << "        \"bitSequence\": [";
-        //        for (int col = 0; col < bitSequence.cols(); col++) {
-        //            if (col < bitSequence.cols() - 1) {
+        //        for (int col = 0; col < bitSequence.size(); col++) {
+        //            if (col < bitSequence.size() - 1) {
         //                file << bitSequence(col) << ", ";
         //            } else {
         //                file << bitSequence(col);
@@ -77,28 +77,28 @@ namespace vernier {
         }
 
         if (document.HasMember("bitSequence") && document["bitSequence"].IsArray()) {
-            bitSequence.resize(1, document["bitSequence"].Size());
-            codeDepth = MegarenaBitSequence::codeDepth(bitSequence.cols());
+            bitSequence.resize(document["bitSequence"].Size());
+            codeDepth = MegarenaBitSequence::codeDepth(bitSequence.size());
             for (rapidjson::SizeType col = 0; col < document["bitSequence"].Size(); col++) {
                 if (document["bitSequence"][col].IsInt()) {
-                    bitSequence(col) = document["bitSequence"][col].GetInt();
+                    bitSequence.set(col, document["bitSequence"][col].GetInt() != 0);
                 } else {
                     Exception("The file is not a valid megarena pattern file, the col " + to_string(col) + " of the bitSequence has a wrong format");
                 }
             }
         } else if (document.HasMember("codeDepth") && document["codeDepth"].IsInt()) {
             codeDepth = document["codeDepth"].GetInt();
-            if (codeDepth >= 4 && codeDepth <= 12) {
+            if (MegarenaBitSequence::isValidCodeDepth(codeDepth)) {
                 MegarenaBitSequence::generate(codeDepth, bitSequence);
             } else {
-                throw Exception("The file is not a valid megarena pattern file, the code depth must between 4 and 12.");
+                throw Exception("The file is not a valid megarena pattern file, the code depth must between " + to_string(MegarenaBitSequence::MIN_CODE_DEPTH) + " and " + to_string(MegarenaBitSequence::MAX_CODE_DEPTH) + ".");
             }
         } else if (document.HasMember("codeSize") && document["codeSize"].IsInt()) {
             codeDepth = document["codeSize"].GetInt();
-            if (codeDepth >= 4 && codeDepth <= 12) {
+            if (MegarenaBitSequence::isValidCodeDepth(codeDepth)) {
                 MegarenaBitSequence::generate(codeDepth, bitSequence);
             } else {
-                throw Exception("The file is not a valid megarena pattern file, the code depth must between 4 and 12.");
+                throw Exception("The file is not a valid megarena pattern file, the code depth must between " + to_string(MegarenaBitSequence::MIN_CODE_DEPTH) + " and " + to_string(MegarenaBitSequence::MAX_CODE_DEPTH) + ".");
             }
         } else {
             throw Exception("The file is not a valid megarena pattern file, the code depth is missing or has a wrong format.");
@@ -121,11 +121,11 @@ namespace vernier {
         }
     }
 
-    void MegarenaPatternLayout::toRectangleVector(std::vector<Rectangle>& rectangleList) {
-        int colStart = (int) (regionOfInterest.x / period);
-        int colStop = (int) ((regionOfInterest.x + regionOfInterest.width) / period);
-        int rowStart = (int) (regionOfInterest.y / period);
-        int rowStop = (int) ((regionOfInterest.y + regionOfInterest.height) / period);
+    void MegarenaPatternLayout::getRegionOfInterestBounds(int & rowStart, int & rowStop, int & colStart, int & colStop) {
+        colStart = (int) (regionOfInterest.x / period);
+        colStop = (int) ((regionOfInterest.x + regionOfInterest.width) / period);
+        rowStart = (int) (regionOfInterest.y / period);
+        rowStop = (int) ((regionOfInterest.y + regionOfInterest.height) / period);
 
         if (colStart < 0) {
             colStart = 0;
@@ -139,18 +139,175 @@ namespace vernier {
         if (rowStop > nRows) {
             rowStop = nRows;
         }
+    }
+
+    void MegarenaPatternLayout::visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) {
+        int rowStart, rowStop, colStart, colStop;
+        getRegionOfInterestBounds(rowStart, rowStop, colStart, colStop);
         double offset = (period / 2 - dotSize) / 2;
+        int first, last;
+        getGridRange(region.x, region.width, offset, period, nCols, first, last);
+        colStart = std::max(colStart, first);
+        colStop = std::min(colStop, last);
+        getGridRange(region.y, region.height, offset, period, nRows, first, last);
+        rowStart = std::max(rowStart, first);
+        rowStop = std::min(rowStop, last);
+
+        // the dots are the products of the row and column bits: only the rows 
+        // with a dot are listed once
+        std::vector<int> rows;
+        for (int row = rowStart; row < rowStop; row++) {
+            if (bitSequence.get(row)) {
+                rows.push_back(row);
+            }
+        }
+
         for (int col = colStart; col < colStop; col++) {
+            if (!bitSequence.get(col)) {
+                continue;
+            }
             double x = col * period + offset;
+            for (size_t i = 0; i < rows.size(); i++) {
+                int row = rows[i];
+                if (col % 3 != 0 || row % 3 != 0) {
+                    visitor(Rectangle(x, row * period + offset, dotSize, dotSize));
+                }
+            }
+        }
+    }
+
+#ifndef WIN32
+
+    gdstk::Cell * MegarenaPatternLayout::createGDSRowCell(const std::string & name, gdstk::Cell * dotCell, int colStart, int colStop, bool missingDots) {
+        gdstk::Cell * cell = (gdstk::Cell *) gdstk::allocate_clear(sizeof (gdstk::Cell));
+        cell->init(name.c_str());
+        double offset = (period / 2 - dotSize) / 2;
+        int col = colStart;
+        while (col < colStop) {
+            int length = 0;
+            while (col + length < colStop && bitSequence.get(col + length) && (!missingDots || (col + length) % 3 != 0)) {
+                length++;
+            }
+            if (length > 0) {
+                appendGDSReferences(cell, dotCell, gdstk::Vec2{col * period + offset, 0.0}, length, 1, gdstk::Vec2{period, 0.0});
+                col += length;
+            } else {
+                col++;
+            }
+        }
+        return cell;
+    }
+
+    gdstk::Cell * MegarenaPatternLayout::convertToGDSCell(std::string name) {
+        if (name == "") {
+            name = classname;
+        }
+
+        int rowStart, rowStop, colStart, colStop;
+        getRegionOfInterestBounds(rowStart, rowStop, colStart, colStop);
+
+        // the dots are the products of the row and column bits, so all the rows
+        // are copies of the same row cell, except the rows multiple of 3 which
+        // miss the dots of the columns multiple of 3
+        gdstk::Cell * dotCell = createGDSDotCell(name + "_DOT", dotSize);
+        gdstk::Cell * rowCells[2] = {NULL, NULL};
+
+        gdstk::Cell * cell = (gdstk::Cell *) gdstk::allocate_clear(sizeof (gdstk::Cell));
+        cell->init(name.c_str());
+        double offset = (period / 2 - dotSize) / 2;
+        int row = rowStart;
+        while (row < rowStop) {
+            int type = (row % 3 == 0);
+            int length = 0;
+            while (row + length < rowStop && bitSequence.get(row + length) && ((row + length) % 3 == 0) == type) {
+                length++;
+            }
+            if (length > 0) {
+                if (rowCells[type] == NULL) {
+                    rowCells[type] = createGDSRowCell(name + (type ? "_ROW3" : "_ROW"), dotCell, colStart, colStop, type);
+                }
+                appendGDSReferences(cell, rowCells[type], gdstk::Vec2{leftMargin, -(row * period + offset + topMargin)}, 1, length, gdstk::Vec2{0.0, -period});
+                row += length;
+            } else {
+                row++;
+            }
+        }
+
+        // the cells which are not referenced are not freed with the layout
+        gdstk::Map<gdstk::Cell*> dependencies = {};
+        cell->get_dependencies(true, dependencies);
+        if (dependencies.get(dotCell->name) == NULL) {
+            dotCell->free_all();
+            gdstk::free_allocation(dotCell);
+        }
+        dependencies.clear();
+
+        appendGDSLabel(cell, 8 * dotSize);
+
+        return cell;
+    }
+
+    gdstk::Cell * MegarenaPatternLayout::createOASISRowCell(const std::string & name, int colStart, int colStop, bool missingDots) {
+        gdstk::Cell * cell = (gdstk::Cell *) gdstk::allocate_clear(sizeof (gdstk::Cell));
+        cell->init(name.c_str());
+        double offset = (period / 2 - dotSize) / 2;
+        int firstCol = -1;
+        std::vector<double> offsets;
+        for (int col = colStart; col < colStop; col++) {
+            if (bitSequence.get(col) && (!missingDots || col % 3 != 0)) {
+                if (firstCol < 0) {
+                    firstCol = col;
+                } else {
+                    offsets.push_back((col - firstCol) * period);
+                }
+            }
+        }
+        if (firstCol >= 0) {
+            appendGDSRectangles(cell, gdstk::Vec2{firstCol * period + offset, 0.0}, dotSize, dotSize, offsets);
+        }
+        return cell;
+    }
+
+    gdstk::Cell * MegarenaPatternLayout::convertToOASISCell(std::string name) {
+        if (name == "") {
+            name = classname;
+        }
+
+        int rowStart, rowStop, colStart, colStop;
+        getRegionOfInterestBounds(rowStart, rowStop, colStart, colStop);
+
+        gdstk::Cell * cell = (gdstk::Cell *) gdstk::allocate_clear(sizeof (gdstk::Cell));
+        cell->init(name.c_str());
+        double offset = (period / 2 - dotSize) / 2;
+        for (int type = 0; type < 2; type++) {
+            // the reference is placed on the last row since the OASIS 
+            // repetitions along y only have positive offsets
+            int lastRow = -1;
             for (int row = rowStart; row < rowStop; row++) {
-                double y = row * period + offset;
-                if (bitSequence(row) && bitSequence(col) && (col % 3 != 0 || row % 3 != 0)) {
-                    rectangleList.push_back(Rectangle(x, y, dotSize, dotSize));
+                if (bitSequence.get(row) && (row % 3 == 0) == type) {
+                    lastRow = row;
+                }
+            }
+            if (lastRow < 0) {
+                continue;
+            }
+            gdstk::Reference * reference = (gdstk::Reference *) gdstk::allocate_clear(sizeof (gdstk::Reference));
+            reference->init(createOASISRowCell(name + (type ? "_ROW3" : "_ROW"), colStart, colStop, type));
+            reference->origin = gdstk::Vec2{leftMargin, -(lastRow * period + offset + topMargin)};
+            for (int row = lastRow - 1; row >= rowStart; row--) {
+                if (bitSequence.get(row) && (row % 3 == 0) == type) {
+                    reference->repetition.type = gdstk::RepetitionType::ExplicitY;
+                    reference->repetition.coords.append((lastRow - row) * period);
                 }
             }
+            cell->reference_array.append(reference);
         }
 
+        appendGDSLabel(cell, 8 * dotSize);
+
+        return cell;
     }
+#endif
 
     double MegarenaPatternLayout::getIntensity(double x, double y) {
         if (x<-0.5 * period || y<-0.5 * period || x > width || y > height) {
@@ -161,7 +318,7 @@ namespace vernier {
             if (col < 0 || row < 0 || col >= nCols || row >= nRows) {
                 return 0;
             } else {
-                if (bitSequence(row) && bitSequence(col) && (col % 3 != 0 || row % 3 != 0)) {
+                if (bitSequence.get(row) && bitSequence.get(col) && (col % 3 != 0 || row % 3 != 0)) {
                     return (1 + cos(2 * PI * x / period)) * (1 + cos(2 * PI * y / period)) / 4;
                 } else {
                     return 0;
@@ -170,6 +327,19 @@ namespace vernier {
         }
     }
 
+    void MegarenaPatternLayout::getIntensities(const double * x, const double * y, double * intensities, int count) {
+        for (int i = 0; i < count; i++) {
+            intensities[i] = MegarenaPatternLayout::getIntensity(x[i], y[i]);
+        }
+    }
+
+    void MegarenaPatternLayout::getPhases(const double * x, const double * y, double * phases1, double * phases2, int count) {
+        for (int i = 0; i < count; i++) {
+            phases1[i] = MegarenaPatternLayout::getPhase1(x[i], y[i]);
+            phases2[i] = MegarenaPatternLayout::getPhase2(x[i], y[i]);
+        }
+    }
+
     double MegarenaPatternLayout::getPhase1(double x, double y) {
         if (x<-0.5 * period || y<-0.5 * period || x > width || y > height) {
             return 0;
@@ -186,24 +356,26 @@ namespace vernier {
         }
     }
 
+    void MegarenaPatternLayout::renderPNGRow(int row, int colStart, int colStop, unsigned char * pixels) {
+        int dotRow = row / 2;
+        if (row < 0 || row % 2 != 0 || dotRow >= nRows || !bitSequence.get(dotRow)) {
+            std::fill(pixels, pixels + (colStop - colStart), 0);
+            return;
+        }
+        bool missingDots = (dotRow % 3 == 0);
+        for (int col = colStart; col < colStop; col++) {
+            int dotCol = col / 2;
+            bool dot = col >= 0 && col % 2 == 0 && dotCol < nCols && bitSequence.get(dotCol) && (!missingDots || dotCol % 3 != 0);
+            pixels[col - colStart] = dot ? 255 : 0;
+        }
+    }
+
     void MegarenaPatternLayout::saveToPNG(std::string filename) {
         int colStart = (int) (regionOfInterest.x / (period * 0.5));
         int colStop = (int) ((regionOfInterest.x + regionOfInterest.width) / (period * 0.5));
         int rowStart = (int) (regionOfInterest.y / (period * 0.5));
         int rowStop = (int) ((regionOfInterest.y + regionOfInterest.height) / (period * 0.5));
-
-        cv::Mat image(rowStop - rowStart, colStop - colStart, CV_8U);
-        for (int col = colStart; col < colStop; col++) {
-            double x = col * period * 0.5 + 0.25 * period - originX;
-            for (int row = rowStart; row < rowStop; row++) {
-                double y = row * period * 0.5 + 0.25 * period - originY;
-                image.at<unsigned char>(row - rowStart, col - colStart) = (unsigned char) (255 * (getIntensity(x, y) > 0.5));
-            }
-        }
-        if (filename == "") {
-            filename = classname + ".png";
-        }
-        cv::imwrite(filename, image);
+        writePNG(filename, rowStart, rowStop, colStart, colStop);
     }
 
     std::string MegarenaPatternLayout::toString() {
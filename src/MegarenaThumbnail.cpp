@@ -26,64 +26,78 @@ namespace vernier {
         this->length1 = length1;
         this->length2 = length2;
 
+        // the arrays keep their memory when the lengths do not change, so that 
+        // the thumbnails of successive images of the same size are computed 
+        // without any allocation
+
         //for the thumbnail
-        numberWhiteDots.resize(length1, length2);
-        cumulWhiteDots.resize(length1, length2);
-        numberBackgroundDots.resize(length1, length2);
-        cumulBackgroundDots.resize(length1, length2);
-
-        numberWhiteDots.fill(0);
-        cumulWhiteDots.fill(0);
-        numberBackgroundDots.fill(0);
-        cumulBackgroundDots.fill(0);
-
-        //for the coded sequences
-        numberWhiteRefDots1.resize(length1);
-        cumulWhiteRefDots1.resize(length1);
-        numberBackRefDots1.resize(length1);
-        cumulBackRefDots1.resize(length1);
-        numberCodingDots1.resize(length1);
-        cumulCodingDots1.resize(length1);
-        meanCodingDots1.resize(length1);
-        meanBackRefDots1.resize(length1);
-        meanWhiteRefDots1.resize(length1);
-
-        numberWhiteRefDots1.fill(0);
-        cumulWhiteRefDots1.fill(0);
-        numberBackRefDots1.fill(0);
-        cumulBackRefDots1.fill(0);
-        numberCodingDots1.fill(0);
-        cumulCodingDots1.fill(0);
-        meanCodingDots1.fill(0);
-        meanBackRefDots1.fill(0);
-        meanWhiteRefDots1.fill(0);
-
-        numberWhiteRefDots2.resize(length2);
-        cumulWhiteRefDots2.resize(length2);
-        numberBackRefDots2.resize(length2);
-        cumulBackRefDots2.resize(length2);
-        numberCodingDots2.resize(length2);
-        cumulCodingDots2.resize(length2);
-        meanCodingDots2.resize(length2);
-        meanBackRefDots2.resize(length2);
-        meanWhiteRefDots2.resize(length2);
-
-        numberWhiteRefDots2.fill(0);
-        cumulWhiteRefDots2.fill(0);
-        numberBackRefDots2.fill(0);
-        cumulBackRefDots2.fill(0);
-        numberCodingDots2.fill(0);
-        cumulCodingDots2.fill(0);
-        meanCodingDots2.fill(0);
-        meanBackRefDots2.fill(0);
-        meanWhiteRefDots2.fill(0);
+        numberWhiteDots.setZero(length1, length2);
+        cumulWhiteDots.setZero(length1, length2);
+        numberBackgroundDots.setZero(length1, length2);
+        cumulBackgroundDots.setZero(length1, length2);
 
         //create the actual sequences
-        sequence1.resize(length1);
-        sequence1.fill(0);
+        sequence1.setZero(length1);
+        sequence2.setZero(length2);
+    }
+
+    void MegarenaThumbnail::computeLineSums() {
+        // single pass in the storage order of the thumbnail: the sums of a row 
+        // are split according to the column index modulo 3 (and conversely) 
+        // so that they can be restricted to the coding dots once the code 
+        // orientation is known
+        rowNumberWhiteDots.setZero(length1, 3);
+        rowCumulWhiteDots.setZero(length1, 3);
+        rowNumberBackgroundDots.setZero(length1);
+        rowCumulBackgroundDots.setZero(length1);
+        colNumberWhiteDots.setZero(length2, 3);
+        colCumulWhiteDots.setZero(length2, 3);
+        colNumberBackgroundDots.setZero(length2);
+        colCumulBackgroundDots.setZero(length2);
+
+        for (int col = 0; col < length2; col++) {
+            int residue2 = col % 3;
+            double colNumberWhite[3] = {0, 0, 0};
+            double colCumulWhite[3] = {0, 0, 0};
+            double colNumberBackground = 0;
+            double colCumulBackground = 0;
+            int residue1 = 0;
+            for (int row = 0; row < length1; row++) {
+                double numberWhite = numberWhiteDots(row, col);
+                double cumulWhite = cumulWhiteDots(row, col);
+                double numberBackground = numberBackgroundDots(row, col);
+                double cumulBackground = cumulBackgroundDots(row, col);
+
+                rowNumberWhiteDots(row, residue2) += numberWhite;
+                rowCumulWhiteDots(row, residue2) += cumulWhite;
+                rowNumberBackgroundDots(row) += numberBackground;
+                rowCumulBackgroundDots(row) += cumulBackground;
+
+                colNumberWhite[residue1] += numberWhite;
+                colCumulWhite[residue1] += cumulWhite;
+                colNumberBackground += numberBackground;
+                colCumulBackground += cumulBackground;
+
+                if (++residue1 == 3) {
+                    residue1 = 0;
+                }
+            }
+            for (int residue = 0; residue < 3; residue++) {
+                colNumberWhiteDots(col, residue) = colNumberWhite[residue];
+                colCumulWhiteDots(col, residue) = colCumulWhite[residue];
+            }
+            colNumberBackgroundDots(col) = colNumberBackground;
+            colCumulBackgroundDots(col) = colCumulBackground;
+        }
 
-        sequence2.resize(length2);
-        sequence2.fill(0);
+        // the global cell is the sum of the rows grouped by their index modulo 3
+        Eigen::Array33d cellNumberWhiteDots = Eigen::Array33d::Zero();
+        Eigen::Array33d cellCumulWhiteDots = Eigen::Array33d::Zero();
+        for (int row = 0; row < length1; row++) {
+            cellNumberWhiteDots.row(row % 3) += rowNumberWhiteDots.row(row);
+            cellCumulWhiteDots.row(row % 3) += rowCumulWhiteDots.row(row);
+        }
+        cell.setGlobalCell(cellNumberWhiteDots, cellCumulWhiteDots);
     }
 
     void MegarenaThumbnail::getCodeSequence() {
@@ -94,17 +108,17 @@ namespace vernier {
 
         int startIndex1 = 0;
         int startIndex2 = 0;
-        int stopIndex1 = numberWhiteDots.rows();
-        int stopIndex2 = numberWhiteDots.cols();
-        
+        int stopIndex1 = length1;
+        int stopIndex2 = length2;
+
         if (coding1 == 0) {
             startIndex1 = 1;
             sequence1(0) = 0;
         }
 
-        if (numberWhiteDots.rows() % 3 == coding1) {
-            stopIndex1 = numberWhiteDots.rows() - 1;
-            sequence1(numberWhiteDots.rows() - 1) = 0;
+        if (length1 % 3 == coding1) {
+            stopIndex1 = length1 - 1;
+            sequence1(length1 - 1) = 0;
         }
 
         if (coding2 == 0) {
@@ -112,111 +126,93 @@ namespace vernier {
             sequence2(0) = 0;
         }
 
-        if (numberWhiteDots.cols() % 3 == coding2) {
-            stopIndex2 = numberWhiteDots.cols() - 1;
-            sequence2(numberWhiteDots.cols() - 1) = 0;
+        if (length2 % 3 == coding2) {
+            stopIndex2 = length2 - 1;
+            sequence2(length2 - 1) = 0;
         }
 
-//        codeIntensity1.resize(stopIndex1 - startIndex1, 3); // Antoine version but wrong size in some case
-//        codeIntensity2.resize(stopIndex2 - startIndex2, 3);
-        codeIntensity1.resize(numberWhiteDots.rows(), 3); // Guillaume fix 
-        codeIntensity2.resize(numberWhiteDots.cols(), 3);
+        // the first and last lines out of the coding range are removed from the sums
+        if (startIndex2 > 0) {
+            removeFromRowSums(0);
+        }
+        if (stopIndex2 < length2) {
+            removeFromRowSums(length2 - 1);
+        }
+        if (startIndex1 > 0) {
+            removeFromColSums(0);
+        }
+        if (stopIndex1 < length1) {
+            removeFromColSums(length1 - 1);
+        }
+
+        codeIntensity1.resize(length1, 3);
+        codeIntensity2.resize(length2, 3);
         codeIntensity1.setConstant(0.0);
         codeIntensity2.setConstant(0.0);
 
         // sequence 1
-
-        //Pour contraste:
-        Eigen::VectorXd contrastVec1;
-        
         for (int index1 = startIndex1; index1 < stopIndex1; index1++) {
-            if (index1 % 3 != coding1 % 3) {
+            if (index1 % 3 != coding1) {
                 sequence1(index1) = 0;
             } else {
-                for (int index2 = startIndex2; index2 < stopIndex2; index2++) {
-                    numberBackRefDots1(index1) += numberBackgroundDots(index1, index2);
-                    cumulBackRefDots1(index1) += cumulBackgroundDots(index1, index2);
-                    // Ici on a deux point sur trois dans une direction qui sont cosid�r�s comme non codants
-                    if (index2 % 3 != coding2 % 3) {
-                        numberCodingDots1(index1) += numberWhiteDots(index1, index2);
-                        cumulCodingDots1(index1) += cumulWhiteDots(index1, index2);
-
-                        if ((index1 - 1) % 3 != missing1 % 3 || index2 % 3 != missing2 % 3) {
-                            numberWhiteRefDots1(index1) += numberWhiteDots(index1 - 1, index2);
-                            cumulWhiteRefDots1(index1) += cumulWhiteDots(index1 - 1, index2);
+                double numberCodingDots = 0, cumulCodingDots = 0, numberWhiteRefDots = 0, cumulWhiteRefDots = 0;
+                // two dots over three of the row are not coding
+                for (int residue2 = 0; residue2 < 3; residue2++) {
+                    if (residue2 != coding2) {
+                        numberCodingDots += rowNumberWhiteDots(index1, residue2);
+                        cumulCodingDots += rowCumulWhiteDots(index1, residue2);
+
+                        if ((index1 - 1) % 3 != missing1 || residue2 != missing2) {
+                            numberWhiteRefDots += rowNumberWhiteDots(index1 - 1, residue2);
+                            cumulWhiteRefDots += rowCumulWhiteDots(index1 - 1, residue2);
                         }
-                        if (((index1 + 1) % 3 != missing1 % 3 || index2 % 3 != missing2 % 3) && index1 < numberWhiteRefDots1.rows() - 2) {
-                            numberWhiteRefDots1(index1) += numberWhiteDots(index1 + 1, index2);
-                            cumulWhiteRefDots1(index1) += cumulWhiteDots(index1 + 1, index2);
+                        if (((index1 + 1) % 3 != missing1 || residue2 != missing2) && index1 < length1 - 2) {
+                            numberWhiteRefDots += rowNumberWhiteDots(index1 + 1, residue2);
+                            cumulWhiteRefDots += rowCumulWhiteDots(index1 + 1, residue2);
                         }
                     }
                 }
 
-                meanCodingDots1(index1) = cumulCodingDots1(index1) / numberCodingDots1(index1);
-                meanBackRefDots1(index1) = cumulBackRefDots1(index1) / numberBackRefDots1(index1);
-                meanWhiteRefDots1(index1) = cumulWhiteRefDots1(index1) / numberWhiteRefDots1(index1);
+                codeIntensity1(index1, 0) = cumulCodingDots / numberCodingDots;
+                codeIntensity1(index1, 1) = rowCumulBackgroundDots(index1) / rowNumberBackgroundDots(index1);
+                codeIntensity1(index1, 2) = cumulWhiteRefDots / numberWhiteRefDots;
 
-                codeIntensity1(index1, 0) = meanCodingDots1(index1);
-                codeIntensity1(index1, 1) = meanBackRefDots1(index1);
-                codeIntensity1(index1, 2) = meanWhiteRefDots1(index1);
-
-                contrastVec1.conservativeResize(contrastVec1.rows() + 1, contrastVec1.cols());
-
-                contrastVec1(contrastVec1.rows() - 1) = (codeIntensity1(index1, 2) - codeIntensity1(index1, 1));
-
-                //std::cout << (codeIntensity1(index1, 2) - codeIntensity1(index1, 1)) / 256.0 << std::endl;
-
-                if (abs(meanCodingDots1(index1) - meanBackRefDots1(index1)) < abs(meanWhiteRefDots1(index1) - meanCodingDots1(index1))) {
+                if (abs(codeIntensity1(index1, 0) - codeIntensity1(index1, 1)) < abs(codeIntensity1(index1, 2) - codeIntensity1(index1, 0))) {
                     sequence1(index1) = -1;
                 } else {
                     sequence1(index1) = 1;
                 }
             }
-            //std::cout << "Index1 " << index1 << std::endl;
         }
 
         // sequence 2
-
-        //Pour contraste:
-        Eigen::VectorXd contrastVec2;
-
         for (int index2 = startIndex2; index2 < stopIndex2; index2++) {
-            if (index2 % 3 != coding2 % 3) {
+            if (index2 % 3 != coding2) {
                 sequence2(index2) = 0;
             } else {
-                for (int index1 = startIndex1; index1 < stopIndex1; index1++) {
-                    numberBackRefDots2(index2) += numberBackgroundDots(index1, index2);
-                    cumulBackRefDots2(index2) += cumulBackgroundDots(index1, index2);
-                    // Ici on a deux point sur trois dans une direction qui sont cosid�r�s comme non codants
-                    if (index1 % 3 != coding1 % 3) {
-                        numberCodingDots2(index2) += numberWhiteDots(index1, index2);
-                        cumulCodingDots2(index2) += cumulWhiteDots(index1, index2);
-
-                        if ((index2 - 1) % 3 != missing2 % 3 || index1 % 3 != missing1 % 3) {
-                            numberWhiteRefDots2(index2) += numberWhiteDots(index1, index2 - 1);
-                            cumulWhiteRefDots2(index2) += cumulWhiteDots(index1, index2 - 1);
+                double numberCodingDots = 0, cumulCodingDots = 0, numberWhiteRefDots = 0, cumulWhiteRefDots = 0;
+                // two dots over three of the column are not coding
+                for (int residue1 = 0; residue1 < 3; residue1++) {
+                    if (residue1 != coding1) {
+                        numberCodingDots += colNumberWhiteDots(index2, residue1);
+                        cumulCodingDots += colCumulWhiteDots(index2, residue1);
+
+                        if ((index2 - 1) % 3 != missing2 || residue1 != missing1) {
+                            numberWhiteRefDots += colNumberWhiteDots(index2 - 1, residue1);
+                            cumulWhiteRefDots += colCumulWhiteDots(index2 - 1, residue1);
                         }
-                        if (((index2 + 1) % 3 != missing2 % 3 || index1 % 3 != missing1 % 3) && index2 < numberWhiteRefDots2.rows() - 2) {
-                            numberWhiteRefDots2(index2) += numberWhiteDots(index1, index2 + 1);
-                            cumulWhiteRefDots2(index2) += cumulWhiteDots(index1, index2 + 1);
+                        if (((index2 + 1) % 3 != missing2 || residue1 != missing1) && index2 < length2 - 2) {
+                            numberWhiteRefDots += colNumberWhiteDots(index2 + 1, residue1);
+                            cumulWhiteRefDots += colCumulWhiteDots(index2 + 1, residue1);
                         }
                     }
                 }
 
-                meanCodingDots2(index2) = cumulCodingDots2(index2) / numberCodingDots2(index2);
-                meanBackRefDots2(index2) = cumulBackRefDots2(index2) / numberBackRefDots2(index2);
-                meanWhiteRefDots2(index2) = cumulWhiteRefDots2(index2) / numberWhiteRefDots2(index2);
-
-                codeIntensity2(index2, 0) = meanCodingDots2(index2);
-                codeIntensity2(index2, 1) = meanBackRefDots2(index2);
-                codeIntensity2(index2, 2) = meanWhiteRefDots2(index2);
-
-                contrastVec2.conservativeResize(contrastVec2.rows() + 1, contrastVec2.cols());
-                contrastVec2(contrastVec2.rows() - 1) = (codeIntensity2(index2, 2) - codeIntensity2(index2, 1));
+                codeIntensity2(index2, 0) = cumulCodingDots / numberCodingDots;
+                codeIntensity2(index2, 1) = colCumulBackgroundDots(index2) / colNumberBackgroundDots(index2);
+                codeIntensity2(index2, 2) = cumulWhiteRefDots / numberWhiteRefDots;
 
-                //std::cout << (codeIntensity2(index2, 2) - codeIntensity2(index2, 1)) / 256.0 << std::endl;
-
-                if (abs(meanCodingDots2(index2) - meanBackRefDots2(index2)) < abs(meanWhiteRefDots2(index2) - meanCodingDots2(index2))) {
+                if (abs(codeIntensity2(index2, 0) - codeIntensity2(index2, 1)) < abs(codeIntensity2(index2, 2) - codeIntensity2(index2, 0))) {
                     sequence2(index2) = -1;
                 } else {
                     sequence2(index2) = 1;
@@ -225,10 +221,30 @@ namespace vernier {
         }
     }
 
+    void MegarenaThumbnail::removeFromRowSums(int col) {
+        int residue2 = col % 3;
+        for (int row = 0; row < length1; row++) {
+            rowNumberWhiteDots(row, residue2) -= numberWhiteDots(row, col);
+            rowCumulWhiteDots(row, residue2) -= cumulWhiteDots(row, col);
+            rowNumberBackgroundDots(row) -= numberBackgroundDots(row, col);
+            rowCumulBackgroundDots(row) -= cumulBackgroundDots(row, col);
+        }
+    }
+
+    void MegarenaThumbnail::removeFromColSums(int row) {
+        int residue1 = row % 3;
+        for (int col = 0; col < length2; col++) {
+            colNumberWhiteDots(col, residue1) -= numberWhiteDots(row, col);
+            colCumulWhiteDots(col, residue1) -= cumulWhiteDots(row, col);
+            colNumberBackgroundDots(col) -= numberBackgroundDots(row, col);
+            colCumulBackgroundDots(col) -= cumulBackgroundDots(row, col);
+        }
+    }
+
     void MegarenaThumbnail::compute(Eigen::ArrayXXd& phase1, Eigen::ArrayXXd& phase2, const Eigen::ArrayXXd& patternArray) {
         computeThumbnail(phase1, phase2, patternArray, PI / 4.0);
 
-        cell.getGlobalCell(numberWhiteDots, cumulWhiteDots);
+        computeLineSums();
         this->codeOrientation = cell.getCodeOrientation();
 
         //cv::Mat codingCellImage(10, 10, CV_64FC3);
@@ -794,15 +810,15 @@ namespace vernier {
         return fullThumbnail;
     }
 
-    Eigen::VectorXd MegarenaThumbnail::getSequence1() {
+    const Eigen::VectorXd& MegarenaThumbnail::getSequence1() {
         return sequence1;
     }
 
-    Eigen::VectorXd MegarenaThumbnail::getSequence2() {
+    const Eigen::VectorXd& MegarenaThumbnail::getSequence2() {
         return sequence2;
     }
 
-    Eigen::VectorXd MegarenaThumbnail::getCodeOrientation() {
+    const Eigen::VectorXd& MegarenaThumbnail::getCodeOrientation() {
         return codeOrientation;
     }
 
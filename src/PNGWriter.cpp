@@ -0,0 +1,147 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2025 CNRS, ENSMM, UMLP.
+ */
+
+#include "PNGWriter.hpp"
+
+namespace vernier {
+
+    PNGWriter::PNGWriter(const std::string & filename, int width, int height, int bitDepth) {
+        if (width <= 0 || height <= 0) {
+            throw Exception("The size of the PNG image must be positive.");
+        }
+        if (bitDepth != 1 && bitDepth != 8) {
+            throw Exception("The bit depth of the PNG image must be 1 or 8.");
+        }
+        this->filename = filename;
+        this->width = width;
+        this->height = height;
+        this->bitDepth = bitDepth;
+        rowCount = 0;
+        closed = false;
+#ifndef WIN32
+        // each row starts with its filter type (0 = none)
+        row.assign(1 + ((size_t) width * bitDepth + 7) / 8, 0);
+        output.resize(1 << 18);
+
+        file.open(filename.c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            throw Exception("Error creating file " + filename);
+        }
+        const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+        file.write((const char *) signature, 8);
+
+        unsigned char header[13] = {
+            (unsigned char) (width >> 24), (unsigned char) (width >> 16), (unsigned char) (width >> 8), (unsigned char) width,
+            (unsigned char) (height >> 24), (unsigned char) (height >> 16), (unsigned char) (height >> 8), (unsigned char) height,
+            (unsigned char) bitDepth, 0, 0, 0, 0
+        };
+        writeChunk("IHDR", header, 13);
+
+        stream = {};
+        if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            throw Exception("Error initializing the compression of " + filename);
+        }
+        stream.next_out = output.data();
+        stream.avail_out = output.size();
+#else
+        image = cv::Mat(height, width, CV_8U);
+#endif
+    }
+
+    PNGWriter::~PNGWriter() {
+        if (!closed) {
+#ifndef WIN32
+            deflateEnd(&stream);
+            file.close();
+#endif
+        }
+    }
+
+    void PNGWriter::writeRow(const unsigned char * pixels) {
+        if (rowCount >= height) {
+            throw Exception("Too many rows written in " + filename);
+        }
+#ifndef WIN32
+        if (bitDepth == 8) {
+            std::copy(pixels, pixels + width, row.begin() + 1);
+        } else {
+            std::fill(row.begin() + 1, row.end(), 0);
+            for (int col = 0; col < width; col++) {
+                if (pixels[col] > 127) {
+                    row[1 + col / 8] |= 128 >> (col % 8);
+                }
+            }
+        }
+        stream.next_in = row.data();
+        stream.avail_in = row.size();
+        compress(Z_NO_FLUSH);
+#else
+        std::copy(pixels, pixels + width, image.ptr<unsigned char>(rowCount));
+#endif
+        rowCount++;
+    }
+
+    void PNGWriter::close() {
+        if (closed) {
+            return;
+        }
+        if (rowCount != height) {
+            throw Exception("Missing rows in " + filename);
+        }
+        closed = true;
+#ifndef WIN32
+        stream.next_in = NULL;
+        stream.avail_in = 0;
+        compress(Z_FINISH);
+        deflateEnd(&stream);
+        writeChunk("IEND", NULL, 0);
+        file.close();
+#else
+        std::vector<int> parameters;
+        if (bitDepth == 1) {
+            parameters.push_back(cv::IMWRITE_PNG_BILEVEL);
+            parameters.push_back(1);
+        }
+        cv::imwrite(filename, image, parameters);
+#endif
+    }
+
+#ifndef WIN32
+
+    void PNGWriter::compress(int flush) {
+        // the compressed data is written in an IDAT chunk each time the output
+        // buffer is full, and at the end of the stream
+        int status;
+        do {
+            status = deflate(&stream, flush);
+            if (status == Z_STREAM_ERROR) {
+                throw Exception("Error compressing " + filename);
+            }
+            if (stream.avail_out == 0 || (status == Z_STREAM_END && stream.avail_out < output.size())) {
+                writeChunk("IDAT", output.data(), output.size() - stream.avail_out);
+                stream.next_out = output.data();
+                stream.avail_out = output.size();
+            }
+        } while (stream.avail_in > 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+    }
+
+    void PNGWriter::writeChunk(const char * type, const unsigned char * data, size_t length) {
+        unsigned char size[4] = {(unsigned char) (length >> 24), (unsigned char) (length >> 16), (unsigned char) (length >> 8), (unsigned char) length};
+        uLong crc = crc32(0L, (const Bytef *) type, 4);
+        if (length > 0) {
+            crc = crc32(crc, data, length);
+        }
+        unsigned char check[4] = {(unsigned char) (crc >> 24), (unsigned char) (crc >> 16), (unsigned char) (crc >> 8), (unsigned char) crc};
+        file.write((const char *) size, 4);
+        file.write(type, 4);
+        if (length > 0) {
+            file.write((const char *) data, length);
+        }
+        file.write((const char *) check, 4);
+    }
+#endif
+
+}
\ No newline at end of file
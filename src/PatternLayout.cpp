@@ -5,6 +5,9 @@
  */
 
 #include "PatternLayout.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace vernier {
 
@@ -22,6 +25,26 @@ namespace vernier {
         bottomMargin = 0.0;
         width = 0.0;
         height = 0.0;
+        supersampling = 1;
+        progressCallback = printProgress;
+    }
+
+    void PatternLayout::setProgressCallback(ProgressCallback callback) {
+        progressCallback = callback;
+    }
+
+    void PatternLayout::printProgress(const std::string & task, double progress) {
+        if (progress < 1.0) {
+            std::cout << " \r " << task << " : " << (int) (100 * progress) << " %            " << std::flush;
+        } else {
+            std::cout << "\r " << task << " : completed            " << std::endl;
+        }
+    }
+
+    void PatternLayout::reportProgress(const std::string & task, double progress) {
+        if (progressCallback) {
+            progressCallback(task, progress);
+        }
     }
 
     void PatternLayout::saveToJSON(std::string filename) {
@@ -136,56 +159,215 @@ namespace vernier {
         readJSON(document.MemberBegin()->value);
     };
 
+    void PatternLayout::getGridRange(double start, double length, double origin, double pitch, int count, int & first, int & last) {
+        first = (int) std::max(0.0, std::min((double) count, std::ceil((start - origin) / pitch)));
+        last = (int) std::max(0.0, std::min((double) count, std::ceil((start + length - origin) / pitch)));
+    }
+
+    int PatternLayout::getThreadCount() {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    void PatternLayout::processTiles(const std::string & task, const std::function<void(int, const Rectangle &)> & process, const std::function<void(int)> & merge) {
+        int threadCount = getThreadCount();
+
+        // the inner tiles split the height of the layout, their boundaries are 
+        // computed so that the bottom of a tile is exactly the top of the next 
+        // one, and two outer tiles catch the dots outside the layout
+        double limit = std::numeric_limits<double>::max();
+        int innerCount = (height > 0.0) ? std::max(100, 4 * threadCount) : 0;
+        std::vector<Rectangle> tiles;
+        tiles.push_back(Rectangle(-0.5 * limit, -0.5 * limit, limit, 0.5 * limit));
+        for (int i = 0; i < innerCount; i++) {
+            double top = i * height / innerCount;
+            double bottom = (i + 1) * height / innerCount;
+            tiles.push_back(Rectangle(-0.5 * limit, top, limit, bottom - top));
+        }
+        tiles.push_back(Rectangle(-0.5 * limit, std::max(0.0, height), limit, 0.5 * limit));
+
+        reportProgress(task, 0.0);
+        for (int start = 0; start < tiles.size(); start += threadCount) {
+            int stop = std::min((int) tiles.size(), start + threadCount);
+#pragma omp parallel for schedule(dynamic)
+            for (int i = start; i < stop; i++) {
+                process(i - start, tiles[i]);
+            }
+            for (int i = start; i < stop; i++) {
+                merge(i - start);
+            }
+            if (stop < tiles.size()) {
+                reportProgress(task, (double) stop / tiles.size());
+            }
+        }
+        reportProgress(task, 1.0);
+    }
+
+    void PatternLayout::writeTiles(std::ostream & stream, const std::string & task, const std::function<void(std::ostream &, const Rectangle &)> & writer) {
+        std::vector<std::ostringstream> buffers(getThreadCount());
+        for (size_t i = 0; i < buffers.size(); i++) {
+            buffers[i].flags(stream.flags());
+            buffers[i].precision(stream.precision());
+        }
+        processTiles(task, [&](int slot, const Rectangle & region) {
+            std::ostringstream & buffer = buffers[slot];
+            visitRectangles([&](const Rectangle & rectangle) {
+                writer(buffer, rectangle);
+            }, region);
+        }, [&](int slot) {
+            stream << buffers[slot].str();
+            buffers[slot].str("");
+        });
+    }
+
+    void PatternLayout::visitAllRectangles(const RectangleVisitor & visitor) {
+        double limit = std::numeric_limits<double>::max();
+        visitRectangles(visitor, Rectangle(-0.5 * limit, -0.5 * limit, limit, limit));
+    }
+
+    size_t PatternLayout::countRectangles() {
+        size_t count = 0;
+        visitAllRectangles([&count](const Rectangle & rectangle) {
+            count++;
+        });
+        return count;
+    }
+
+    void PatternLayout::toRectangleVector(std::vector<Rectangle>& rectangleList) {
+        rectangleList.reserve(rectangleList.size() + countRectangles());
+        visitAllRectangles([&rectangleList](const Rectangle & rectangle) {
+            rectangleList.push_back(rectangle);
+        });
+    }
+
+    void PatternLayout::writeSVGRectangles(std::ostream & stream, std::vector<Rectangle> & rectangles, std::map<std::string, std::string> & patterns) {
+        std::sort(rectangles.begin(), rectangles.end(), [](const Rectangle & a, const Rectangle & b) {
+            if (a.y != b.y) {
+                return a.y < b.y;
+            } else if (a.height != b.height) {
+                return a.height < b.height;
+            } else if (a.width != b.width) {
+                return a.width < b.width;
+            } else {
+                return a.x < b.x;
+            }
+        });
+        auto isSameRow = [](const Rectangle & a, const Rectangle & b) {
+            return a.y == b.y && a.width == b.width && a.height == b.height;
+        };
+
+        // the identical dots evenly spaced along a row are drawn with a single
+        // rectangle filled with a pattern, defined once per pitch and dot size
+        size_t start = 0;
+        while (start < rectangles.size()) {
+            const Rectangle & first = rectangles[start];
+            size_t stop = start + 1;
+            if (stop < rectangles.size() && isSameRow(first, rectangles[stop])) {
+                double pitch = rectangles[stop].x - first.x;
+                if (pitch >= first.width) {
+                    while (stop + 1 < rectangles.size() && isSameRow(first, rectangles[stop + 1]) && areClose(rectangles[stop + 1].x - rectangles[stop].x, pitch)) {
+                        stop++;
+                    }
+                    stop++;
+                }
+            }
+            size_t count = stop - start;
+            if (count >= 3) {
+                double pitch = (rectangles[stop - 1].x - first.x) / (count - 1);
+                std::ostringstream id;
+                id.precision(stream.precision());
+                id << "row" << pitch << "_" << first.width << "_" << first.height;
+                if (patterns.count(id.str()) == 0) {
+                    std::ostringstream pattern;
+                    pattern.precision(stream.precision());
+                    pattern << "<pattern id=\"" << id.str() << "\" patternUnits=\"userSpaceOnUse\" width=\"" << pitch << "\" height=\"" << first.height << "\">";
+                    pattern << "<rect width=\"" << first.width << "\" height=\"" << first.height << "\" /></pattern>\n";
+                    patterns[id.str()] = pattern.str();
+                }
+                stream << "<rect transform=\"translate(" << first.x << " " << first.y << ")\" ";
+                stream << "width=\"" << count * pitch << "\" height=\"" << first.height << "\" fill=\"url(#" << id.str() << ")\" />\n";
+            } else {
+                for (size_t i = start; i < stop; i++) {
+                    stream << "<rect x=\"" << rectangles[i].x << "\" y=\"" << rectangles[i].y << "\" ";
+                    stream << "width=\"" << rectangles[i].width << "\" height=\"" << rectangles[i].height << "\" />\n";
+                }
+            }
+            start = stop;
+        }
+    }
+
     void PatternLayout::saveToSVG(std::string filename) {
         if (filename == "") {
             filename = classname + ".svg";
         }
 
+        std::vector<char> fileBuffer(1 << 20);
         std::ofstream file;
+        file.rdbuf()->pubsetbuf(fileBuffer.data(), fileBuffer.size());
         file.open(filename.c_str());
         if (!file.is_open()) {
             throw Exception("Error creating file" + filename);
         }
 
         file.precision(15);
-        file << "<?xml version=\"1.0\" encoding=\"utf-8\"?>" << std::endl;
-        file << "<!-- Created with the Vernier library -->" << std::endl;
-        file << "<svg" << std::endl;
-        file << "    xmlns=\"http://www.w3.org/2000/svg\"" << std::endl;
-        file << "    version=\"1.1\"" << std::endl;
-        file << "    x=\"0\" y=\"0\" width=\"" << width + leftMargin + rightMargin << "\" height=\"" << height + topMargin + bottomMargin << "\"" << std::endl;
-        file << "    viewBox=\"0 0 " << width + leftMargin + rightMargin << " " << height + topMargin + bottomMargin << "\">" << std::endl;
-        file << "<title>" << description << "</title>" << std::endl;
-        file << "<desc>" << std::endl;
-        file << "    class: " << classname << std::endl;
-        file << "    description: " << description << std::endl;
-        file << "    date: " << date << std::endl;
-        file << "    author: " << author << std::endl;
-        file << "    unit: " << unit << std::endl;
-        file << "    width: " << width << std::endl;
-        file << "    height: " << height << std::endl;
-        file << "    originX: " << originX << std::endl;
-        file << "    originY: " << originY << std::endl;
-        file << "    leftMargin: " << leftMargin << std::endl;
-        file << "    rightMargin: " << rightMargin << std::endl;
-        file << "    topMargin: " << topMargin << std::endl;
-        file << "    bottomMargin: " << bottomMargin << std::endl;
-        file << "</desc>" << std::endl;
-        std::vector<Rectangle> rectangleList;
-        toRectangleVector(rectangleList);
-        for (int i = 0; i < rectangleList.size(); i++) {
-            file << "<rect x=\"" << rectangleList[i].x + leftMargin << "\" ";
-            file << "y=\"" << rectangleList[i].y + topMargin << "\" ";
-            file << "width=\"" << rectangleList[i].width << "\" ";
-            file << "height=\"" << rectangleList[i].height << "\" ";
-            file << "fill=\"black\" />" << std::endl;
-            if (i % (rectangleList.size() / 100) == 0) {
-                std::cout << " \r Writing " << filename << " : " << 100 * i / rectangleList.size() << " %            " << std::flush;
+        file << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+        file << "<!-- Created with the Vernier library -->\n";
+        file << "<svg\n";
+        file << "    xmlns=\"http://www.w3.org/2000/svg\"\n";
+        file << "    version=\"1.1\"\n";
+        file << "    x=\"0\" y=\"0\" width=\"" << width + leftMargin + rightMargin << "\" height=\"" << height + topMargin + bottomMargin << "\"\n";
+        file << "    viewBox=\"0 0 " << width + leftMargin + rightMargin << " " << height + topMargin + bottomMargin << "\">\n";
+        file << "<title>" << description << "</title>\n";
+        file << "<desc>\n";
+        file << "    class: " << classname << "\n";
+        file << "    description: " << description << "\n";
+        file << "    date: " << date << "\n";
+        file << "    author: " << author << "\n";
+        file << "    unit: " << unit << "\n";
+        file << "    width: " << width << "\n";
+        file << "    height: " << height << "\n";
+        file << "    originX: " << originX << "\n";
+        file << "    originY: " << originY << "\n";
+        file << "    leftMargin: " << leftMargin << "\n";
+        file << "    rightMargin: " << rightMargin << "\n";
+        file << "    topMargin: " << topMargin << "\n";
+        file << "    bottomMargin: " << bottomMargin << "\n";
+        file << "</desc>\n";
+        file << "<g transform=\"translate(" << leftMargin << " " << topMargin << ")\" fill=\"black\">\n";
+
+        // the tiles are sorted and written in parallel, the patterns they use 
+        // are gathered and defined at the end of the file
+        std::vector<std::ostringstream> buffers(getThreadCount());
+        std::vector<std::map<std::string, std::string> > tilePatterns(buffers.size());
+        std::map<std::string, std::string> patterns;
+        for (size_t i = 0; i < buffers.size(); i++) {
+            buffers[i].precision(file.precision());
+        }
+        processTiles("Writing " + filename, [&](int slot, const Rectangle & region) {
+            std::vector<Rectangle> rectangles;
+            visitRectangles([&rectangles](const Rectangle & rectangle) {
+                rectangles.push_back(rectangle);
+            }, region);
+            writeSVGRectangles(buffers[slot], rectangles, tilePatterns[slot]);
+        }, [&](int slot) {
+            file << buffers[slot].str();
+            buffers[slot].str("");
+            patterns.insert(tilePatterns[slot].begin(), tilePatterns[slot].end());
+            tilePatterns[slot].clear();
+        });
+        file << "</g>\n";
+        if (patterns.size() > 0) {
+            file << "<defs>\n";
+            for (auto it = patterns.begin(); it != patterns.end(); ++it) {
+                file << it->second;
             }
+            file << "</defs>\n";
         }
-        file << "</svg>" << std::endl;
+        file << "</svg>\n";
         file.close();
-        std::cout << "\r Writing " << filename << " : completed            " << std::endl;
     }
 
     void PatternLayout::saveToLayoutEditorMacro(std::string filename) {
@@ -204,49 +386,190 @@ namespace vernier {
         file << "#help=This macro was generated with the Vernier library." << std::endl;
         file << std::endl;
         file << "int main() {" << std::endl;
-        std::vector<Rectangle> rectangleList;
-        toRectangleVector(rectangleList);
-        for (int i = 0; i < rectangleList.size(); i++) {
-            file << "layout->drawing->point(" << 1000 * (rectangleList[i].x + leftMargin) << "," << -1000 * (rectangleList[i].y + topMargin) << ");" << std::endl;
-            file << "layout->drawing->point(" << 1000 * (rectangleList[i].x + leftMargin + rectangleList[i].width) << "," << -1000 * (rectangleList[i].y + topMargin + rectangleList[i].height) << ");" << std::endl;
-            file << "layout->drawing->box();" << std::endl;
-            if (i % (rectangleList.size() / 100) == 0) {
-                std::cout << " \r Writing " << filename << " : " << 100 * i / rectangleList.size() << " %            " << std::flush;
-            }
-        }
+        writeTiles(file, "Writing " + filename, [this](std::ostream & stream, const Rectangle & rectangle) {
+            stream << "layout->drawing->point(" << 1000 * (rectangle.x + leftMargin) << "," << -1000 * (rectangle.y + topMargin) << ");\n";
+            stream << "layout->drawing->point(" << 1000 * (rectangle.x + leftMargin + rectangle.width) << "," << -1000 * (rectangle.y + topMargin + rectangle.height) << ");\n";
+            stream << "layout->drawing->box();\n";
+        });
         file << "}" << std::endl;
         file.close();
-        std::cout << "\r Writing " << filename << " : completed            " << std::endl;
     }
 
 #ifndef WIN32
 
+    gdstk::Cell * PatternLayout::createGDSDotCell(const std::string & name, double dotSize) {
+        gdstk::Cell * cell = (gdstk::Cell *) gdstk::allocate_clear(sizeof (gdstk::Cell));
+        cell->init(name.c_str());
+        gdstk::Polygon * polygon = (gdstk::Polygon *) gdstk::allocate_clear(sizeof (gdstk::Polygon));
+        *polygon = gdstk::rectangle(gdstk::Vec2{0.0, 0.0}, gdstk::Vec2{dotSize, -dotSize}, gdstk::make_tag(1, 1));
+        cell->polygon_array.append(polygon);
+        return cell;
+    }
+
+    void PatternLayout::appendGDSReferences(gdstk::Cell * cell, gdstk::Cell * referencedCell, gdstk::Vec2 origin, int columns, int rows, gdstk::Vec2 spacing) {
+        for (int row = 0; row < rows; row += UINT16_MAX) {
+            for (int col = 0; col < columns; col += UINT16_MAX) {
+                gdstk::Reference * reference = (gdstk::Reference *) gdstk::allocate_clear(sizeof (gdstk::Reference));
+                reference->init(referencedCell);
+                reference->origin = gdstk::Vec2{origin.x + col * spacing.x, origin.y + row * spacing.y};
+                int subColumns = std::min(columns - col, (int) UINT16_MAX);
+                int subRows = std::min(rows - row, (int) UINT16_MAX);
+                if (subColumns > 1 || subRows > 1) {
+                    reference->repetition.type = gdstk::RepetitionType::Rectangular;
+                    reference->repetition.columns = subColumns;
+                    reference->repetition.rows = subRows;
+                    reference->repetition.spacing = spacing;
+                }
+                cell->reference_array.append(reference);
+            }
+        }
+    }
+
+    void PatternLayout::appendGDSRectangles(gdstk::Cell * cell, gdstk::Vec2 corner, double width, double height, int columns, int rows, gdstk::Vec2 spacing) {
+        gdstk::Polygon * polygon = (gdstk::Polygon *) gdstk::allocate_clear(sizeof (gdstk::Polygon));
+        *polygon = gdstk::rectangle(corner, gdstk::Vec2{corner.x + width, corner.y - height}, gdstk::make_tag(1, 1));
+        if (columns > 1 || rows > 1) {
+            polygon->repetition.type = gdstk::RepetitionType::Rectangular;
+            polygon->repetition.columns = columns;
+            polygon->repetition.rows = rows;
+            polygon->repetition.spacing = spacing;
+        }
+        cell->polygon_array.append(polygon);
+    }
+
+    void PatternLayout::appendGDSRectangles(gdstk::Cell * cell, gdstk::Vec2 corner, double width, double height, const std::vector<double> & offsets) {
+        gdstk::Polygon * polygon = (gdstk::Polygon *) gdstk::allocate_clear(sizeof (gdstk::Polygon));
+        *polygon = gdstk::rectangle(corner, gdstk::Vec2{corner.x + width, corner.y - height}, gdstk::make_tag(1, 1));
+        if (offsets.size() > 0) {
+            polygon->repetition.type = gdstk::RepetitionType::ExplicitX;
+            polygon->repetition.coords.ensure_slots(offsets.size());
+            for (int i = 0; i < offsets.size(); i++) {
+                polygon->repetition.coords.append(offsets[i]);
+            }
+        }
+        cell->polygon_array.append(polygon);
+    }
+
+    void PatternLayout::appendGDSLabel(gdstk::Cell * cell, double size) {
+        gdstk::Array<gdstk::Polygon*> all_text = {};
+        gdstk::text(toString().c_str(), size, gdstk::Vec2{0, -(topMargin + height + bottomMargin + size)}, false, 2, all_text);
+        cell->polygon_array.extend(all_text);
+        all_text.clear();
+    }
+
     gdstk::Cell * PatternLayout::convertToGDSCell(std::string name) {
         if (name == "") {
             name = classname;
         }
 
-        std::vector<vernier::Rectangle> rectangleList;
-        toRectangleVector(rectangleList);
-
-        gdstk::Cell * cell = new gdstk::Cell();
+        gdstk::Cell * cell = (gdstk::Cell *) gdstk::allocate_clear(sizeof (gdstk::Cell));
         cell->init(name.c_str());
-        for (int i = 0; i < rectangleList.size(); i++) {
-            gdstk::Polygon * polygon = new gdstk::Polygon(gdstk::rectangle(gdstk::Vec2{rectangleList[i].x + leftMargin, -(rectangleList[i].y + topMargin)}, gdstk::Vec2{rectangleList[i].x + rectangleList[i].width + leftMargin, -(rectangleList[i].y + rectangleList[i].height + topMargin)}, gdstk::make_tag(1, 1)));
-            cell->polygon_array.append(polygon);
-            if (i % (rectangleList.size() / 100) == 0) {
-                std::cout << " \r Building cell " << name << " : " << 100 * i / rectangleList.size() << " %            " << std::flush;
+        double labelSize = 0.0;
+        std::vector<std::vector<gdstk::Polygon *> > polygons(getThreadCount());
+        processTiles("Building cell " + name, [&](int slot, const Rectangle & region) {
+            visitRectangles([&](const Rectangle & rectangle) {
+                gdstk::Polygon * polygon = (gdstk::Polygon *) gdstk::allocate_clear(sizeof (gdstk::Polygon));
+                *polygon = gdstk::rectangle(gdstk::Vec2{rectangle.x + leftMargin, -(rectangle.y + topMargin)}, gdstk::Vec2{rectangle.x + rectangle.width + leftMargin, -(rectangle.y + rectangle.height + topMargin)}, gdstk::make_tag(1, 1));
+                polygons[slot].push_back(polygon);
+            }, region);
+        }, [&](int slot) {
+            if (cell->polygon_array.count == 0 && polygons[slot].size() > 0) {
+                labelSize = 8 * (polygons[slot][0]->point_array[0].y - polygons[slot][0]->point_array[2].y);
             }
-        }
+            cell->polygon_array.ensure_slots(polygons[slot].size());
+            for (size_t i = 0; i < polygons[slot].size(); i++) {
+                cell->polygon_array.append(polygons[slot][i]);
+            }
+            polygons[slot].clear();
+        });
 
         //        rectangleList.push_back(Rectangle(0.0, 0.0, leftMargin + width + rightMargin, topMargin));
         //        rectangleList.push_back(Rectangle(0.0, topMargin, leftMargin, height));
         //        rectangleList.push_back(Rectangle(leftMargin + width, topMargin, rightMargin, height));
         //        rectangleList.push_back(Rectangle(0.0, topMargin + height, leftMargin + width + rightMargin, bottomMargin));
 
-        gdstk::Array<gdstk::Polygon*> all_text = {};
-        gdstk::text(toString().c_str(), 8 * rectangleList[0].height, gdstk::Vec2{0, -(topMargin + height + bottomMargin + 8 * rectangleList[0].height)}, false, 2, all_text);
-        cell->polygon_array.extend(all_text);
+        appendGDSLabel(cell, labelSize);
+
+        return cell;
+    }
+
+    gdstk::Cell * PatternLayout::convertToOASISCell(std::string name) {
+        if (name == "") {
+            name = classname;
+        }
+
+        std::vector<vernier::Rectangle> rectangleList;
+        toRectangleVector(rectangleList);
+        double labelSize = 8 * rectangleList[0].height;
+
+        // the rectangles are sorted by size and by row, so that the identical 
+        // rectangles of a row become a single rectangle repeated along x (with
+        // a regular repetition when they are evenly spaced) and the evenly 
+        // spaced rows with the same regular repetition are merged in a grid
+        std::sort(rectangleList.begin(), rectangleList.end(), [](const Rectangle & a, const Rectangle & b) {
+            if (a.width != b.width) {
+                return a.width < b.width;
+            } else if (a.height != b.height) {
+                return a.height < b.height;
+            } else if (a.y != b.y) {
+                return a.y < b.y;
+            } else {
+                return a.x < b.x;
+            }
+        });
+
+        gdstk::Cell * cell = (gdstk::Cell *) gdstk::allocate_clear(sizeof (gdstk::Cell));
+        cell->init(name.c_str());
+        Rectangle grid;
+        gdstk::Vec2 gridSpacing = {0.0, 0.0};
+        int gridColumns = 0;
+        int gridRows = 0;
+        std::vector<double> offsets;
+        size_t start = 0;
+        while (start < rectangleList.size()) {
+            const Rectangle & first = rectangleList[start];
+            size_t stop = start + 1;
+            while (stop < rectangleList.size() && rectangleList[stop].width == first.width && rectangleList[stop].height == first.height && rectangleList[stop].y == first.y) {
+                stop++;
+            }
+            int columns = stop - start;
+            double spacing = (columns > 1) ? rectangleList[start + 1].x - first.x : 0.0;
+            bool regular = true;
+            for (size_t i = start + 2; i < stop && regular; i++) {
+                regular = areClose(rectangleList[i].x - rectangleList[i - 1].x, spacing);
+            }
+
+            if (regular && gridRows > 0 && first.width == grid.width && first.height == grid.height && areClose(first.x, grid.x)
+                    && columns == gridColumns && areClose(spacing, gridSpacing.x) && (gridRows == 1 || areClose(first.y - grid.y, gridRows * gridSpacing.y))) {
+                if (gridRows == 1) {
+                    gridSpacing.y = first.y - grid.y;
+                }
+                gridRows++;
+            } else {
+                if (gridRows > 0) {
+                    appendGDSRectangles(cell, gdstk::Vec2{grid.x + leftMargin, -(grid.y + topMargin)}, grid.width, grid.height, gridColumns, gridRows, gdstk::Vec2{gridSpacing.x, -gridSpacing.y});
+                }
+                if (regular) {
+                    grid = first;
+                    gridSpacing = gdstk::Vec2{spacing, 0.0};
+                    gridColumns = columns;
+                    gridRows = 1;
+                } else {
+                    offsets.clear();
+                    for (size_t i = start + 1; i < stop; i++) {
+                        offsets.push_back(rectangleList[i].x - first.x);
+                    }
+                    appendGDSRectangles(cell, gdstk::Vec2{first.x + leftMargin, -(first.y + topMargin)}, first.width, first.height, offsets);
+                    gridRows = 0;
+                }
+            }
+            start = stop;
+        }
+        if (gridRows > 0) {
+            appendGDSRectangles(cell, gdstk::Vec2{grid.x + leftMargin, -(grid.y + topMargin)}, grid.width, grid.height, gridColumns, gridRows, gdstk::Vec2{gridSpacing.x, -gridSpacing.y});
+        }
+
+        appendGDSLabel(cell, labelSize);
 
         return cell;
     }
@@ -260,16 +583,18 @@ namespace vernier {
         lib.init(classname.c_str(), 1e-6, 1e-9);
         gdstk::Cell * cell = convertToGDSCell();
         lib.cell_array.append(cell);
+        gdstk::Map<gdstk::Cell*> dependencies = {};
+        cell->get_dependencies(true, dependencies);
+        dependencies.to_array(lib.cell_array);
+        dependencies.clear();
 
-        std::cout << "\r Writing " << filename << " : starting...            " << std::flush;
+        reportProgress("Writing " + filename, 0.0);
         lib.write_gds(filename.c_str(), 0, NULL);
         //lib.write_oas(filename.c_str(), 0, 6, OASIS_CONFIG_DETECT_ALL);
         //cell->write_svg(filename.c_str(), 10, 6, NULL, NULL, "#222222", 5, true, NULL);
 
-        lib.clear();
-        cell->clear(); // possible memory leak: are polygons really deleted?
-        delete cell;
-        std::cout << "\r Writing " << filename << " : completed            " << std::endl;
+        lib.free_all();
+        reportProgress("Writing " + filename, 1.0);
     }
 
     void PatternLayout::saveToOASIS(std::string filename) {
@@ -279,18 +604,20 @@ namespace vernier {
 
         gdstk::Library lib = {};
         lib.init(classname.c_str(), 1e-6, 1e-9);
-        gdstk::Cell * cell = convertToGDSCell();
+        gdstk::Cell * cell = convertToOASISCell();
         lib.cell_array.append(cell);
+        gdstk::Map<gdstk::Cell*> dependencies = {};
+        cell->get_dependencies(true, dependencies);
+        dependencies.to_array(lib.cell_array);
+        dependencies.clear();
 
-        std::cout << "\r Writing " << filename << " : starting...            " << std::flush;
+        reportProgress("Writing " + filename, 0.0);
         //lib.write_gds(filename.c_str(), 0, NULL);
         lib.write_oas(filename.c_str(), 0, 6, OASIS_CONFIG_DETECT_ALL);
         //cell->write_svg(filename.c_str(), 10, 6, NULL, NULL, "#222222", 5, true, NULL);
 
-        lib.clear();
-        cell->clear(); // possible memory leak: are polygons really deleted?
-        delete cell;
-        std::cout << "\r Writing " << filename << " : completed            " << std::endl;
+        lib.free_all();
+        reportProgress("Writing " + filename, 1.0);
     }
 #endif
 
@@ -306,18 +633,72 @@ namespace vernier {
         }
         file.precision(15);
         file << "x;y;width;height:intensity" << std::endl;
-        std::vector<Rectangle> rectangleList;
-        toRectangleVector(rectangleList);
-        for (int i = 0; i < rectangleList.size(); i++) {
-            file << rectangleList[i].x << ";";
-            file << rectangleList[i].y << ";";
-            file << rectangleList[i].width << ";";
-            file << rectangleList[i].height << ";";
-            file << "1" << std::endl;
-        }
+        writeTiles(file, "Writing " + filename, [](std::ostream & stream, const Rectangle & rectangle) {
+            stream << rectangle.x << ";";
+            stream << rectangle.y << ";";
+            stream << rectangle.width << ";";
+            stream << rectangle.height << ";";
+            stream << "1\n";
+        });
         file.close();
     }
 
+    void PatternLayout::getIntensities(const double * x, const double * y, double * intensities, int count) {
+        for (int i = 0; i < count; i++) {
+            intensities[i] = getIntensity(x[i], y[i]);
+        }
+    }
+
+    void PatternLayout::getPhases(const double * x, const double * y, double * phases1, double * phases2, int count) {
+        for (int i = 0; i < count; i++) {
+            phases1[i] = getPhase1(x[i], y[i]);
+            phases2[i] = getPhase2(x[i], y[i]);
+        }
+    }
+
+    void PatternLayout::renderHomography(const Eigen::Matrix3d & inversedHomography, Eigen::ArrayXXd & outputImage) {
+        int samples = std::max(1, supersampling);
+        int rows = outputImage.rows();
+        Eigen::Vector3d rowStep = inversedHomography.col(1);
+#pragma omp parallel for
+        for (int col = 0; col < outputImage.cols(); col++) {
+            Eigen::ArrayXd x(rows), y(rows), intensities(rows);
+            outputImage.col(col).setZero();
+            for (int sample = 0; sample < samples * samples; sample++) {
+                // the homogeneous coordinates of the pattern points are an affine
+                // function of the row, so a single product is needed per column
+                Eigen::Vector3d pointImage(col + (sample % samples + 0.5) / samples - 0.5, (sample / samples + 0.5) / samples - 0.5, 1.0);
+                Eigen::Vector3d start = inversedHomography * pointImage;
+                for (int row = 0; row < rows; row++) {
+                    Eigen::Vector3d pointPattern = start + row * rowStep;
+                    x(row) = pointPattern.x() / pointPattern.z();
+                    y(row) = pointPattern.y() / pointPattern.z();
+                }
+                getIntensities(x.data(), y.data(), intensities.data(), rows);
+                outputImage.col(col) += intensities;
+            }
+            if (samples > 1) {
+                outputImage.col(col) /= samples * samples;
+            }
+        }
+    }
+
+    void PatternLayout::renderPhaseHomography(const Eigen::Matrix3d & inversedHomography, Eigen::ArrayXXd & outputPhase1, Eigen::ArrayXXd & outputPhase2) {
+        int rows = outputPhase1.rows();
+        Eigen::Vector3d rowStep = inversedHomography.col(1);
+#pragma omp parallel for
+        for (int col = 0; col < outputPhase1.cols(); col++) {
+            Eigen::ArrayXd x(rows), y(rows);
+            Eigen::Vector3d start = inversedHomography * Eigen::Vector3d(col, 0.0, 1.0);
+            for (int row = 0; row < rows; row++) {
+                Eigen::Vector3d pointPattern = start + row * rowStep;
+                x(row) = pointPattern.x() / pointPattern.z();
+                y(row) = pointPattern.y() / pointPattern.z();
+            }
+            getPhases(x.data(), y.data(), outputPhase1.col(col).data(), outputPhase2.col(col).data(), rows);
+        }
+    }
+
     void PatternLayout::renderOrthographicProjection(Pose pose, cv::Mat & outputImage) {
         renderOrthographicProjection(pose, outputImage, 1.0 / pose.pixelSize);
     }
@@ -361,13 +742,7 @@ namespace vernier {
         Eigen::Matrix3d homography = cameraMatrix * cTp * M;
         Eigen::Matrix3d inversedHomography = homography.inverse();
 
-        for (int col = 0; col < outputImage.cols(); col++) {
-            for (int row = 0; row < outputImage.rows(); row++) {
-                Eigen::Vector3d pointImage(col, row, 1);
-                Eigen::Vector3d pointPattern = inversedHomography * pointImage;
-                outputImage(row, col) = this->getIntensity(pointPattern.x(), pointPattern.y());
-            }
-        }
+        renderHomography(inversedHomography, outputImage);
     }
     
     void PatternLayout::renderPerspectiveProjection(Pose pose, cv::Mat & outputImage, double focalLength, Eigen::Vector2d principalPoint) {
@@ -405,14 +780,7 @@ namespace vernier {
         Eigen::Matrix3d homography = cameraMatrix * cTp * M;
         Eigen::Matrix3d inversedHomography = homography.inverse();
 
-        for (int col = 0; col < outputImage.cols(); col++) {
-            for (int row = 0; row < outputImage.rows(); row++) {
-                Eigen::Vector3d pointImage(col, row, 1);
-                Eigen::Vector3d pointPattern = inversedHomography * pointImage;
-                pointPattern /= pointPattern.z();
-                outputImage(row, col) = this->getIntensity(pointPattern.x(), pointPattern.y());
-            }
-        }
+        renderHomography(inversedHomography, outputImage);
     }
 
     void PatternLayout::renderUCMProjection(Pose pose, cv::Mat & outputImage, double focalLength, double xi, Eigen::Vector2d principalPoint) {
@@ -447,32 +815,36 @@ namespace vernier {
         Eigen::Vector3d planPose(pose.x, pose.y, pose.z - xi);
         Eigen::Vector3d planNormal = (inverseTransform * Eigen::Vector4d(0.0, 0.0, 1.0, 0.0)).head<3>().normalized();
 
+        int samples = std::max(1, supersampling);
+#pragma omp parallel for
         for (int col = 0; col < outputImage.cols(); col++) {
             for (int row = 0; row < outputImage.rows(); row++) {
-                // Projection of Xi (homogeneous coordinates of the 2D point in the sensor plane) to 
-                // Xpi (normalized image frame) using the inverse of the intrinsic matrix
-                Eigen::Vector3d pointImage(col, row, 1);
-                Eigen::Vector3d pointCamera = inverseCameraMatrix * pointImage;
-
-                // Projection of Xpi (normalized image frame) to Xs (surface of the sphere) using 
-                // the inverse of the omnidirectional distortion model
-                double sommeCarres = pointCamera.norm() - 1;
-                double lambda1 = (xi + sqrt(1 + (1 - xi * xi) * sommeCarres)) / (sommeCarres + 1);
-                Eigen::Vector3d pointSphere = pointCamera * lambda1;
-                
-                // Projection of Xs (surface of the sphere) to Xp (object plane) using the 
-                // intersection of the ray defined by Xs and the plane defined by the pattern (Z=0)
-                double lambda2 = planNormal.dot(planPose) / planNormal.dot(pointSphere - xiVector);
-                Eigen::Vector3d pointPattern = (pointSphere * lambda2) + xiVector * (1 - lambda2);
-
-                // Check if the calculated lambda2 value is negative, which means that the point 
-                // is projected behind the camera
-                if (lambda2 <= 0) {
-                    outputImage(row, col) = 0.0;
-                } else {
-                    Eigen::Vector4d pointPatternHomogeneous = inverseTransform * pointPattern.homogeneous();
-                    outputImage(row, col) = this->getIntensity(pointPatternHomogeneous.x(), pointPatternHomogeneous.y());
+                double intensity = 0.0;
+                for (int sample = 0; sample < samples * samples; sample++) {
+                    // Projection of Xi (homogeneous coordinates of the 2D point in the sensor plane) to 
+                    // Xpi (normalized image frame) using the inverse of the intrinsic matrix
+                    Eigen::Vector3d pointImage(col + (sample % samples + 0.5) / samples - 0.5, row + (sample / samples + 0.5) / samples - 0.5, 1);
+                    Eigen::Vector3d pointCamera = inverseCameraMatrix * pointImage;
+
+                    // Projection of Xpi (normalized image frame) to Xs (surface of the sphere) using 
+                    // the inverse of the omnidirectional distortion model
+                    double sommeCarres = pointCamera.norm() - 1;
+                    double lambda1 = (xi + sqrt(1 + (1 - xi * xi) * sommeCarres)) / (sommeCarres + 1);
+                    Eigen::Vector3d pointSphere = pointCamera * lambda1;
+
+                    // Projection of Xs (surface of the sphere) to Xp (object plane) using the 
+                    // intersection of the ray defined by Xs and the plane defined by the pattern (Z=0)
+                    double lambda2 = planNormal.dot(planPose) / planNormal.dot(pointSphere - xiVector);
+                    Eigen::Vector3d pointPattern = (pointSphere * lambda2) + xiVector * (1 - lambda2);
+
+                    // Check if the calculated lambda2 value is negative, which means that the point 
+                    // is projected behind the camera
+                    if (lambda2 > 0) {
+                        Eigen::Vector4d pointPatternHomogeneous = inverseTransform * pointPattern.homogeneous();
+                        intensity += this->getIntensity(pointPatternHomogeneous.x(), pointPatternHomogeneous.y());
+                    }
                 }
+                outputImage(row, col) = intensity / (samples * samples);
             }
         }
     }   
@@ -520,15 +892,7 @@ namespace vernier {
         Eigen::Matrix3d homography = cameraMatrix * cTp * M;
         Eigen::Matrix3d inversedHomography = homography.inverse();
 
-        for (int col = 0; col < outputPhase1.cols(); col++) {
-            for (int row = 0; row < outputPhase1.rows(); row++) {
-                Eigen::Vector3d pointImage(col, row, 1);
-                Eigen::Vector3d pointPattern = inversedHomography * pointImage;
-                pointPattern /= pointPattern.z();
-                outputPhase1(row, col) = this->getPhase1(pointPattern.x(), pointPattern.y());
-                outputPhase2(row, col) = this->getPhase2(pointPattern.x(), pointPattern.y());
-            }
-        }
+        renderPhaseHomography(inversedHomography, outputPhase1, outputPhase2);
     }
 
     void PatternLayout::renderPhaseImagesUCMProjection(Pose pose, cv::Mat & outputPhase1, cv::Mat & outputPhase2,
@@ -571,6 +935,7 @@ namespace vernier {
         Eigen::Vector3d planPose(pose.x, pose.y, pose.z - xi);
         Eigen::Vector3d planNormal = (inverseTransform * Eigen::Vector4d(0.0, 0.0, 1.0, 0.0)).head<3>().normalized();
 
+#pragma omp parallel for
         for (int col = 0; col < outputPhase1.cols(); col++) {
             for (int row = 0; row < outputPhase1.rows(); row++) {
                 // Projection of Xi (homogeneous coordinates of the 2D point in the sensor plane) to 
@@ -659,6 +1024,9 @@ namespace vernier {
     }
 
     int PatternLayout::getInt(const std::string & attribute) {
+        if (attribute == "supersampling") {
+            return supersampling;
+        }
         throw Exception("The parameter " + attribute + " is not accessible or defined in class " + classname + ".");
     }
 
@@ -708,6 +1076,10 @@ namespace vernier {
     }
 
     void PatternLayout::setInt(const std::string & attribute, int value) {
+        if (attribute == "supersampling") {
+            supersampling = value;
+            return;
+        }
         std::cout << "The parameter " + attribute + " is not accessible or defined in class " + classname + "." << std::endl;
     }
 
@@ -36,8 +36,13 @@ namespace vernier {
 
     void PatternPhase::compute(const Eigen::ArrayXXd& image) {
         resize(image.rows(), image.cols());
-        spatial.setZero();
-        spatial.real() = image;
+        spatial = image.cast<std::complex<double> >();
+        compute();
+    }
+
+    void PatternPhase::compute(const Eigen::ArrayXXd& array, int x, int y, const Eigen::ArrayXXd& window) {
+        resize(window.rows(), window.cols());
+        takeWindowedSnapshot(x, y, array, window, spatial);
         compute();
     }
 
@@ -301,6 +306,20 @@ namespace vernier {
         return plane2;
     }
 
+    Eigen::Vector2d PatternPhase::getFringesCenter() {
+        Eigen::ArrayXXd magnitude = phase1.abs() * phase2.abs();
+        magnitude = (magnitude - 0.5 * magnitude.maxCoeff()).max(0.0);
+        double sum = magnitude.sum();
+        if (sum <= 0.0) {
+            return Eigen::Vector2d(0.0, 0.0);
+        }
+        Eigen::ArrayXd colSums = magnitude.colwise().sum().transpose();
+        Eigen::ArrayXd rowSums = magnitude.rowwise().sum();
+        double x = (colSums * Eigen::ArrayXd::LinSpaced(magnitude.cols(), 0, magnitude.cols() - 1)).sum() / sum - magnitude.cols() / 2;
+        double y = (rowSums * Eigen::ArrayXd::LinSpaced(magnitude.rows(), 0, magnitude.rows() - 1)).sum() / sum - magnitude.rows() / 2;
+        return Eigen::Vector2d(x, y);
+    }
+
     void PatternPhase::setCropFactor(double cropFactor) {
         regressionPlane.setCropFactor(cropFactor);
     }
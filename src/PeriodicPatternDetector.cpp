@@ -13,6 +13,11 @@ namespace vernier {
         ASSERT_MSG(physicalPeriod > 0.0, "The period must be positive.");
         classname = "PeriodicPattern";
         this->physicalPeriod = physicalPeriod;
+        trackingWindowSize = 0;
+        windowCentered = false;
+        windowTracked = false;
+        windowX = 0;
+        windowY = 0;
     }
 
     void PeriodicPatternDetector::readJSON(const rapidjson::Value& document) {
@@ -26,13 +31,54 @@ namespace vernier {
     }
 
     void PeriodicPatternDetector::computeImage() {
+        windowTracked = false;
+        if (windowCentered && trackingWindowSize <= array.rows() && trackingWindowSize <= array.cols()) {
+            if (trackingWindow.rows() != trackingWindowSize) {
+                trackingWindow.setOnes(trackingWindowSize, trackingWindowSize);
+            }
+            patternPhase.compute(array, windowX, windowY, trackingWindow);
+            windowTracked = patternPhase.peaksFound();
+        }
+        if (windowTracked) {
+            periodShift1 = 0;
+            periodShift2 = 0;
+            plane1 = patternPhase.getPlane1();
+            plane2 = patternPhase.getPlane2();
+
+            // the planes of the window are moved to the center of the image (the 
+            // phases are wrapped as the phases at the center of a full image)
+            plane1.setC(angleInPiPi(plane1.getPhase(array.rows() / 2 - windowY, array.cols() / 2 - windowX)));
+            plane2.setC(angleInPiPi(plane2.getPhase(array.rows() / 2 - windowY, array.cols() / 2 - windowX)));
+        } else {
+            computeFullImage();
+        }
+        centerTrackingWindow();
+    }
+
+    void PeriodicPatternDetector::computeFullImage() {
+        windowTracked = false;
+        windowX = array.cols() / 2;
+        windowY = array.rows() / 2;
         patternPhase.compute(array);
+
         periodShift1 = 0;
         periodShift2 = 0;
         plane1 = patternPhase.getPlane1();
         plane2 = patternPhase.getPlane2();
     }
 
+    void PeriodicPatternDetector::centerTrackingWindow() {
+        // the next window is centered on the fringes and kept inside the image
+        windowCentered = false;
+        if (trackingWindowSize > 0 && patternPhase.peaksFound()) {
+            Eigen::Vector2d center = patternPhase.getFringesCenter();
+            int halfSize = trackingWindowSize / 2;
+            windowX = std::max(halfSize, std::min((int) std::round(windowX + center.x()), (int) array.cols() - halfSize));
+            windowY = std::max(halfSize, std::min((int) std::round(windowY + center.y()), (int) array.rows() - halfSize));
+            windowCentered = true;
+        }
+    }
+
     Pose PeriodicPatternDetector::get2DPose(int id) {
         double x = -plane1.getPosition(physicalPeriod, 0.0, 0.0, periodShift1);
         double y = -plane2.getPosition(physicalPeriod, 0.0, 0.0, periodShift2);
@@ -194,14 +240,36 @@ namespace vernier {
         this->patternPhase.setSmoothingKernelSize(smoothingKernelSize);
     }
 
+    void PeriodicPatternDetector::setTrackingWindowSize(int trackingWindowSize) {
+        if (trackingWindowSize < 0 || trackingWindowSize % 2 != 0) {
+            throw Exception("The size of the tracking window must be positive and even.");
+        }
+        this->trackingWindowSize = trackingWindowSize;
+        windowCentered = false;
+    }
+
     void PeriodicPatternDetector::setInt(const std::string & attribute, int value) {
         if (attribute == "smoothingKernelSize") {
             setSmoothingKernelSize(value);
+        } else if (attribute == "trackingWindowSize") {
+            setTrackingWindowSize(value);
         } else {
             PatternDetector::setInt(attribute, value);
         }
     }
 
+    int PeriodicPatternDetector::getInt(const std::string & attribute) {
+        if (attribute == "trackingWindowSize") {
+            return trackingWindowSize;
+        } else if (attribute == "windowX") {
+            return windowX;
+        } else if (attribute == "windowY") {
+            return windowY;
+        } else {
+            return PatternDetector::getInt(attribute);
+        }
+    }
+
     void PeriodicPatternDetector::setDouble(const std::string & attribute, double value) {
         if (attribute == "physicalPeriod") {
             setPhysicalPeriod(value);
@@ -245,7 +313,11 @@ namespace vernier {
     }
 
     bool PeriodicPatternDetector::getBool(const std::string & attribute) {
-        return PatternDetector::getBool(attribute);
+        if (attribute == "windowTracked") {
+            return windowTracked;
+        } else {
+            return PatternDetector::getBool(attribute);
+        }
     }
 
     void PeriodicPatternDetector::setBool(const std::string & attribute, bool value) {
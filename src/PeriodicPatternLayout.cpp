@@ -5,6 +5,7 @@
  */
 
 #include "PeriodicPatternLayout.hpp"
+#include "PNGWriter.hpp"
 
 namespace vernier {
 
@@ -14,6 +15,7 @@ namespace vernier {
     PeriodicPatternLayout::PeriodicPatternLayout(double period, int nRows, int nCols)
     : PatternLayout() {
         classname = "PeriodicPattern";
+        pngBitDepth = 8;
         resize(period, nRows, nCols);
     }
 
@@ -67,14 +69,17 @@ namespace vernier {
         }
     }
 
-    void PeriodicPatternLayout::toRectangleVector(std::vector<Rectangle>& rectangleList) {
+    void PeriodicPatternLayout::visitRectangles(const RectangleVisitor & visitor, const Rectangle & region) {
         double offset = (period / 2 - dotSize) / 2;
-        for (int col = 0; col < nCols; col++) {
+        int colStart, colStop, rowStart, rowStop;
+        getGridRange(region.x, region.width, offset, period, nCols, colStart, colStop);
+        getGridRange(region.y, region.height, offset, period, nRows, rowStart, rowStop);
+        for (int col = colStart; col < colStop; col++) {
             double x = col * period + offset;
-            for (int row = 0; row < nRows; row++) {
+            for (int row = rowStart; row < rowStop; row++) {
                 double y = row * period + offset;
                 if (row != 0 || col != 0) {
-                    rectangleList.push_back(Rectangle(x, y, dotSize, dotSize));
+                    visitor(Rectangle(x, y, dotSize, dotSize));
                 }
             }
         }
@@ -90,6 +95,33 @@ namespace vernier {
         }
     }
 
+    void PeriodicPatternLayout::getIntensities(const double * x, const double * y, double * intensities, int count) {
+        // same computation as getIntensity with the bounds hoisted out of the 
+        // loop and without branches, so that the loop can be vectorized
+        double left = -0.5 * width;
+        double top = -0.5 * height;
+        double right = 0.5 * width;
+        double bottom = 0.5 * height;
+        for (int i = 0; i < count; i++) {
+            bool inside = x[i] >= left && y[i] >= top && x[i] <= right && y[i] <= bottom;
+            bool missingDot = x[i] < left + period && y[i] < top + period;
+            double intensity = (1 + cos(2 * PI * x[i] / period)) * (1 + cos(2 * PI * y[i] / period)) / 4;
+            intensities[i] = (inside && !missingDot) ? intensity : 0.0;
+        }
+    }
+
+    void PeriodicPatternLayout::getPhases(const double * x, const double * y, double * phases1, double * phases2, int count) {
+        double left = -0.5 * width;
+        double top = -0.5 * height;
+        double right = 0.5 * width;
+        double bottom = 0.5 * height;
+        for (int i = 0; i < count; i++) {
+            bool inside = x[i] >= left && y[i] >= top && x[i] <= right && y[i] <= bottom;
+            phases1[i] = inside ? 2 * PI * x[i] / period : 0.0;
+            phases2[i] = inside ? 2 * PI * y[i] / period : 0.0;
+        }
+    }
+
     double PeriodicPatternLayout::getPhase1(double x, double y) {
         if (x < -0.5 * width || y < -0.5 * height || x > 0.5 * width || y > 0.5 * height) {
             return 0;
@@ -106,19 +138,47 @@ namespace vernier {
         }
     }
 
-    void PeriodicPatternLayout::saveToPNG(std::string filename) {
-        cv::Mat image(2 * nRows - 1, 2 * nCols - 1, CV_8U);
-        for (int col = 0; col < image.cols; col++) {
-            double x = col * period * 0.5 + 0.25 * period - originX;
-            for (int row = 0; row < image.rows; row++) {
-                double y = row * period * 0.5 + 0.25 * period - originY;
-                image.at<unsigned char>(row, col) = (unsigned char) (255 * (getIntensity(x, y) > 0.5));
-            }
+    void PeriodicPatternLayout::renderPNGRow(int row, int colStart, int colStop, unsigned char * pixels) {
+        int cols = colStop - colStart;
+        std::vector<double> x(cols), y(cols, row * period * 0.5 + 0.25 * period - originY), intensities(cols);
+        for (int col = colStart; col < colStop; col++) {
+            x[col - colStart] = col * period * 0.5 + 0.25 * period - originX;
+        }
+        getIntensities(x.data(), y.data(), intensities.data(), cols);
+        for (int col = 0; col < cols; col++) {
+            pixels[col] = (unsigned char) (255 * (intensities[col] > 0.5));
         }
+    }
+
+    void PeriodicPatternLayout::writePNG(std::string filename, int rowStart, int rowStop, int colStart, int colStop) {
         if (filename == "") {
             filename = classname + ".png";
         }
-        cv::imwrite(filename, image);
+
+        int stripHeight = 256;
+        size_t cols = colStop - colStart;
+        std::vector<unsigned char> strip(stripHeight * cols);
+        PNGWriter writer(filename, colStop - colStart, rowStop - rowStart, pngBitDepth);
+        reportProgress("Writing " + filename, 0.0);
+        for (int start = rowStart; start < rowStop; start += stripHeight) {
+            int stop = std::min(rowStop, start + stripHeight);
+#pragma omp parallel for
+            for (int row = start; row < stop; row++) {
+                renderPNGRow(row, colStart, colStop, &strip[(row - start) * cols]);
+            }
+            for (int row = start; row < stop; row++) {
+                writer.writeRow(&strip[(row - start) * cols]);
+            }
+            if (stop < rowStop) {
+                reportProgress("Writing " + filename, (double) (stop - rowStart) / (rowStop - rowStart));
+            }
+        }
+        writer.close();
+        reportProgress("Writing " + filename, 1.0);
+    }
+
+    void PeriodicPatternLayout::saveToPNG(std::string filename) {
+        writePNG(filename, 0, 2 * nRows - 1, 0, 2 * nCols - 1);
     }
 
     std::string PeriodicPatternLayout::toString() {
@@ -152,11 +212,21 @@ namespace vernier {
             return nRows;
         } else if (attribute == "nCols") {
             return nCols;
+        } else if (attribute == "pngBitDepth") {
+            return pngBitDepth;
         } else {
             return PatternLayout::getInt(attribute);
         }
     }
 
+    void PeriodicPatternLayout::setInt(const std::string & attribute, int value) {
+        if (attribute == "pngBitDepth") {
+            pngBitDepth = value;
+        } else {
+            PatternLayout::setInt(attribute, value);
+        }
+    }
+
     void PeriodicPatternLayout::setDouble(const std::string & attribute, double value) {
         if (attribute == "dotSize") {
             dotSize = value;
@@ -60,18 +60,46 @@ namespace vernier {
         return dotCount;
     }
     
-    void QRCodeDetector::computeDistances() {
-        int size = fiducialDetector.fiducials.size();
-        distance.resize(size);
-        for (int i = 0; i < size; i++) {
-            distance[i].resize(size);
+    void QRCodeDetector::computeGrid(int markerCount) {
+        std::vector<cv::Point2d> positions(markerCount);
+        for (int i = 0; i < markerCount; i++) {
+            positions[i] = fiducialDetector.fiducials[i].position;
         }
-        for (int i = 0; i < size; i++) {
-            distance[i][i] = 0.0;
-            for (int j = i + 1; j < size; j++) {
-                distance[i][j] = distance[j][i] = cv::norm(fiducialDetector.fiducials[i].position - fiducialDetector.fiducials[j].position);
+        grid.build(positions, 1.0, 1.0);
+    }
+
+    int QRCodeDetector::findClosestMarker(int marker, const std::vector<bool>& assigned) {
+        std::vector<QRFiducialPattern>& fiducials = fiducialDetector.fiducials;
+        int markerCol = grid.getCol(fiducials[marker].position.x);
+        int markerRow = grid.getRow(fiducials[marker].position.y);
+        int closest = -1;
+        double min = 1e150;
+        int maxRing = std::max(grid.rows, grid.cols);
+        // the markers of the ring r and beyond are at least at r-1 cells, and 
+        // the ties are resolved by the lowest index as in an exhaustive search
+        for (int ring = 0; ring <= maxRing && !(closest >= 0 && min < (ring - 1) * grid.cellSize); ring++) {
+            for (int row = markerRow - ring; row <= markerRow + ring; row++) {
+                if (row < 0 || row >= grid.rows) continue;
+                bool borderRow = (row == markerRow - ring || row == markerRow + ring);
+                for (int col = markerCol - ring; col <= markerCol + ring; col += (borderRow ? 1 : 2 * ring)) {
+                    if (col >= 0 && col < grid.cols) {
+                        int cell = row * grid.cols + col;
+                        for (int k = grid.cellStarts[cell]; k < grid.cellStarts[cell + 1]; k++) {
+                            int i = grid.cellItems[k];
+                            if (!assigned[i]) {
+                                double distance = cv::norm(fiducials[marker].position - fiducials[i].position);
+                                if (distance < min || (distance == min && i < closest)) {
+                                    closest = i;
+                                    min = distance;
+                                }
+                            }
+                        }
+                    }
+                    if (ring == 0) break;
+                }
             }
         }
+        return closest;
     }
 
     void QRCodeDetector::makeFirstClustering() {
@@ -95,26 +123,12 @@ namespace vernier {
             assigned[a] = true;
 
             // looking for a first closest marker
-            int b;
-            double min = 1e150;
-            for (int i = 0; i < markerCount; i++) {
-                if (!assigned[i] && distance[a][i] < min) {
-                    b = i;
-                    min = distance[a][i];
-                }
-            }
+            int b = findClosestMarker(a, assigned);
             clusters[currentCluster].push_back(b);
             assigned[b] = true;
 
             // looking for a second closest marker
-            int c;
-            min = 1e150;
-            for (int i = 0; i < markerCount; i++) {
-                if (!assigned[i] && distance[a][i] < min) {
-                    c = i;
-                    min = distance[a][i];
-                }
-            }
+            int c = findClosestMarker(a, assigned);
             clusters[currentCluster].push_back(c);
             assigned[c] = true;
 
@@ -136,17 +150,67 @@ namespace vernier {
         }
     }
 
-    void QRCodeDetector::compute(const cv::Mat& image) {
-        fiducialDetector.compute(image);
+    void QRCodeDetector::findCodes() {
         codes.clear();
         if (fiducialDetector.fiducials.size() >= 3) {
-            computeDistances();
+            computeGrid(3 * (fiducialDetector.fiducials.size() / 3));
             makeFirstClustering();
             //refineClusteringUsingKMeans();
             recordCodes();
         }
     }
 
+    void QRCodeDetector::compute(const cv::Mat& image) {
+        std::vector<cv::Rect> regions = tracker.getRegions(image.size());
+        std::vector<cv::Point2d> centers;
+        std::vector<double> radii;
+
+        tracked = false;
+        if (!regions.empty()) {
+            std::vector<QRFiducialPattern> fiducials;
+            for (int i = 0; i < regions.size(); i++) {
+                fiducialDetector.compute(image(regions[i]));
+                for (int j = 0; j < fiducialDetector.fiducials.size(); j++) {
+                    fiducials.push_back(fiducialDetector.fiducials[j]);
+                    fiducials.back().position += cv::Point2d(regions[i].x, regions[i].y);
+                }
+            }
+            // same order as the fiducials of a full frame (descending pattern count)
+            std::stable_sort(fiducials.begin(), fiducials.end(), [](const QRFiducialPattern & a, const QRFiducialPattern & b) {
+                return a.patternCount > b.patternCount;
+            });
+            fiducialDetector.fiducials = fiducials;
+            findCodes();
+            for (int i = 0; i < codes.size(); i++) {
+                centers.push_back(codes[i].center);
+                radii.push_back(codes[i].getRadius());
+            }
+            tracked = tracker.update(centers, radii, false);
+        }
+
+        if (!tracked) {
+            fiducialDetector.compute(image);
+            findCodes();
+            centers.clear();
+            radii.clear();
+            for (int i = 0; i < codes.size(); i++) {
+                centers.push_back(codes[i].center);
+                radii.push_back(codes[i].getRadius());
+            }
+            tracker.update(centers, radii, true);
+        }
+    }
+
+    void QRCodeDetector::setTrackingMode(bool trackingMode) {
+        tracker.trackingMode = trackingMode;
+        tracker.reset();
+        tracked = false;
+    }
+
+    bool QRCodeDetector::isTracked() {
+        return tracked;
+    }
+
     void QRCodeDetector::draw(cv::Mat& image) {
         for (int i = 0; i < codes.size(); i++) {
             codes[i].draw(image);
@@ -164,7 +228,11 @@ namespace vernier {
     }
     
     void QRCodeDetector::showControlImages() {
-        cv::imshow("Canny image", fiducialDetector.cannyImage);
+        if (fiducialDetector.runLengthScan) {
+            cv::imshow("Binary image", fiducialDetector.binaryImage);
+        } else {
+            cv::imshow("Canny image", fiducialDetector.cannyImage);
+        }
     }
 
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
  */
 
 #include "QRFiducialDetector.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
 
 namespace vernier {
 
@@ -135,53 +138,206 @@ namespace vernier {
     }
 
     void QRFiducialDetector::findRowPatterns() {
-        rowPatterns.clear();
-        int pixelIndex = 0;
-        for (int y = 0; y < cannyImage.rows; y++) {
-            int egdeCount = 0;
-            int insideEdge = false;
-            int edgeStart;
-            QRRowPattern rowPattern(y);
-            for (int x = 0; x < cannyImage.cols - 1; x++) {
-                if (cannyImage.data[pixelIndex] > 0 && !insideEdge) { // entering an edge
-                    insideEdge = true;
-                    edgeStart = x;
-                } else if (cannyImage.data[pixelIndex] == 0 && cannyImage.data[pixelIndex + 1] == 0 && insideEdge) { // exiting an edge
-                    insideEdge = false;
-                    rowPattern.pushCol(((x - 1) + edgeStart) / 2);
-                    egdeCount++;
-                    if (egdeCount >= 6 && rowPattern.isWellProportioned(proportionToleranceInPixels)) {
-                        rowPatterns.push_back(rowPattern);
+        // the bands of rows are scanned in parallel and their patterns are 
+        // gathered in the order of the bands (same order as a serial scan)
+        int bandCount = (cannyImage.rows + SCAN_BAND_SIZE - 1) / SCAN_BAND_SIZE;
+        rowBandPatterns.resize(bandCount);
+#pragma omp parallel for schedule(dynamic)
+        for (int band = 0; band < bandCount; band++) {
+            std::vector<QRRowPattern>& patterns = rowBandPatterns[band];
+            patterns.clear();
+            int lastRow = std::min((band + 1) * SCAN_BAND_SIZE, cannyImage.rows);
+            for (int y = band * SCAN_BAND_SIZE; y < lastRow; y++) {
+                const unsigned char* pixel = cannyImage.ptr<unsigned char>(y);
+                int egdeCount = 0;
+                bool insideEdge = false;
+                int edgeStart;
+                QRRowPattern rowPattern(y);
+                for (int x = 0; x < cannyImage.cols - 1; x++) {
+                    if (pixel[x] > 0 && !insideEdge) { // entering an edge
+                        insideEdge = true;
+                        edgeStart = x;
+                    } else if (pixel[x] == 0 && pixel[x + 1] == 0 && insideEdge) { // exiting an edge
+                        insideEdge = false;
+                        rowPattern.pushCol(((x - 1) + edgeStart) / 2);
+                        egdeCount++;
+                        if (egdeCount >= 6 && rowPattern.isWellProportioned(proportionToleranceInPixels)) {
+                            patterns.push_back(rowPattern);
+                        }
                     }
                 }
-                pixelIndex++;
             }
-            pixelIndex++;
+        }
+
+        rowPatterns.clear();
+        for (int band = 0; band < bandCount; band++) {
+            rowPatterns.insert(rowPatterns.end(), rowBandPatterns[band].begin(), rowBandPatterns[band].end());
         }
     }
 
     void QRFiducialDetector::findColPatterns() {
-        colPatterns.clear();
-        for (int x = 0; x < cannyImage.cols; x++) {
-            int egdeCount = 0;
-            int pixelIndex = x;
-            bool insideEdge = false;
-            int edgeStart;
-            QRColumnPattern colPattern(x);
+        // the columns of a band are scanned together row after row, so that 
+        // the pixels are read contiguously, and the bands are scanned in parallel
+        int bandCount = (cannyImage.cols + SCAN_BAND_SIZE - 1) / SCAN_BAND_SIZE;
+        colBandPatterns.resize(bandCount);
+#pragma omp parallel for schedule(dynamic)
+        for (int band = 0; band < bandCount; band++) {
+            std::vector<QRColumnPattern>& patterns = colBandPatterns[band];
+            patterns.clear();
+            int firstCol = band * SCAN_BAND_SIZE;
+            int bandWidth = std::min((int) SCAN_BAND_SIZE, cannyImage.cols - firstCol);
+            int egdeCount[SCAN_BAND_SIZE] = {0};
+            bool insideEdge[SCAN_BAND_SIZE] = {false};
+            int edgeStart[SCAN_BAND_SIZE];
+            std::vector<QRColumnPattern> colPattern;
+            for (int i = 0; i < bandWidth; i++) {
+                colPattern.push_back(QRColumnPattern(firstCol + i));
+            }
             for (int y = 0; y < cannyImage.rows - 1; y++) {
-                if (cannyImage.data[pixelIndex] > 0 && !insideEdge) { // entering an edge
-                    insideEdge = true;
-                    edgeStart = y;
-                } else if (cannyImage.data[pixelIndex] == 0 && cannyImage.data[pixelIndex + cannyImage.cols] == 0 && insideEdge) { // exiting an edge
-                    insideEdge = false;
-                    colPattern.pushRow(((y - 1) + edgeStart) / 2);
-                    egdeCount++;
-                    if (egdeCount >= 6 && colPattern.isWellProportioned(proportionToleranceInPixels)) {
-                        colPatterns.push_back(colPattern);
+                const unsigned char* pixel = cannyImage.ptr<unsigned char>(y) + firstCol;
+                const unsigned char* nextPixel = cannyImage.ptr<unsigned char>(y + 1) + firstCol;
+                for (int i = 0; i < bandWidth; i++) {
+                    if (pixel[i] > 0 && !insideEdge[i]) { // entering an edge
+                        insideEdge[i] = true;
+                        edgeStart[i] = y;
+                    } else if (pixel[i] == 0 && nextPixel[i] == 0 && insideEdge[i]) { // exiting an edge
+                        insideEdge[i] = false;
+                        colPattern[i].pushRow(((y - 1) + edgeStart[i]) / 2);
+                        egdeCount[i]++;
+                        if (egdeCount[i] >= 6 && colPattern[i].isWellProportioned(proportionToleranceInPixels)) {
+                            patterns.push_back(colPattern[i]);
+                        }
                     }
                 }
-                pixelIndex += cannyImage.cols;
             }
+            // the patterns of each column are found in ascending rows
+            std::stable_sort(patterns.begin(), patterns.end(), [](const QRColumnPattern& a, const QRColumnPattern & b) {
+                return a.col < b.col;
+            });
+        }
+
+        colPatterns.clear();
+        for (int band = 0; band < bandCount; band++) {
+            colPatterns.insert(colPatterns.end(), colBandPatterns[band].begin(), colBandPatterns[band].end());
+        }
+    }
+
+    /** Returns true if the five runs between the six boundaries have the 
+     * proportions 1:1:3:1:1 of a finder pattern (the outer runs within half a 
+     * module and the center run within one and a half modules)
+     */
+    static bool hasFinderProportions(const int* boundaries) {
+        int module2 = 2 * (boundaries[5] - boundaries[0]); // 14 modules in half-units
+        int runs[5];
+        for (int i = 0; i < 5; i++) {
+            runs[i] = 14 * (boundaries[i + 1] - boundaries[i]);
+        }
+        return (std::abs(runs[0] - module2) < module2 / 2 && std::abs(runs[1] - module2) < module2 / 2 &&
+                std::abs(runs[2] - 3 * module2) < 3 * module2 / 2 &&
+                std::abs(runs[3] - module2) < module2 / 2 && std::abs(runs[4] - module2) < module2 / 2);
+    }
+
+    /** Shifts a new boundary into the last six boundaries of a line */
+    static void pushBoundary(int* boundaries, int position) {
+        for (int i = 0; i < 5; i++) {
+            boundaries[i] = boundaries[i + 1];
+        }
+        boundaries[5] = position;
+    }
+
+    void QRFiducialDetector::findRowRunPatterns() {
+        int bandCount = (binaryImage.rows + SCAN_BAND_SIZE - 1) / SCAN_BAND_SIZE;
+        rowBandPatterns.resize(bandCount);
+#pragma omp parallel for schedule(dynamic)
+        for (int band = 0; band < bandCount; band++) {
+            std::vector<QRRowPattern>& patterns = rowBandPatterns[band];
+            patterns.clear();
+            int lastRow = std::min((band + 1) * SCAN_BAND_SIZE, binaryImage.rows);
+            for (int y = band * SCAN_BAND_SIZE; y < lastRow; y++) {
+                const unsigned char* pixel = binaryImage.ptr<unsigned char>(y);
+                int boundaryCount = 0;
+                int boundaries[6];
+                unsigned char value = pixel[0];
+                QRRowPattern rowPattern(y);
+                int x = 1;
+                while (x < binaryImage.cols) {
+                    // skipping the pixels of the current run eight at a time
+                    uint64_t run = 0x0101010101010101ULL * value;
+                    uint64_t word;
+                    while (x + 8 <= binaryImage.cols && (std::memcpy(&word, pixel + x, 8), word == run)) {
+                        x += 8;
+                    }
+                    while (x < binaryImage.cols && pixel[x] == value) {
+                        x++;
+                    }
+                    if (x < binaryImage.cols) { // boundary between two runs
+                        value = pixel[x];
+                        rowPattern.pushCol(x);
+                        pushBoundary(boundaries, x);
+                        boundaryCount++;
+                        // the runs alternate, so the first run of the finder has 
+                        // the opposite colour of the run following it
+                        if (boundaryCount >= 6 && (value == 0) == lightFinders && hasFinderProportions(boundaries)) {
+                            patterns.push_back(rowPattern);
+                        }
+                        x++;
+                    }
+                }
+            }
+        }
+
+        rowPatterns.clear();
+        for (int band = 0; band < bandCount; band++) {
+            rowPatterns.insert(rowPatterns.end(), rowBandPatterns[band].begin(), rowBandPatterns[band].end());
+        }
+    }
+
+    void QRFiducialDetector::findColRunPatterns() {
+        int bandCount = (binaryImage.cols + SCAN_BAND_SIZE - 1) / SCAN_BAND_SIZE;
+        colBandPatterns.resize(bandCount);
+#pragma omp parallel for schedule(dynamic)
+        for (int band = 0; band < bandCount; band++) {
+            std::vector<QRColumnPattern>& patterns = colBandPatterns[band];
+            patterns.clear();
+            int firstCol = band * SCAN_BAND_SIZE;
+            int bandWidth = std::min((int) SCAN_BAND_SIZE, binaryImage.cols - firstCol);
+            int boundaryCount[SCAN_BAND_SIZE] = {0};
+            int boundaries[SCAN_BAND_SIZE][6];
+            std::vector<QRColumnPattern> colPattern;
+            for (int i = 0; i < bandWidth; i++) {
+                colPattern.push_back(QRColumnPattern(firstCol + i));
+            }
+            for (int y = 1; y < binaryImage.rows; y++) {
+                const unsigned char* pixel = binaryImage.ptr<unsigned char>(y) + firstCol;
+                const unsigned char* previousPixel = binaryImage.ptr<unsigned char>(y - 1) + firstCol;
+                int i = 0;
+                while (i < bandWidth) {
+                    // skipping eight columns at a time when they continue their runs
+                    uint64_t word, previousWord;
+                    if (i + 8 <= bandWidth && (std::memcpy(&word, pixel + i, 8), std::memcpy(&previousWord, previousPixel + i, 8), word == previousWord)) {
+                        i += 8;
+                        continue;
+                    }
+                    if (pixel[i] != previousPixel[i]) { // boundary between two runs
+                        colPattern[i].pushRow(y);
+                        pushBoundary(boundaries[i], y);
+                        boundaryCount[i]++;
+                        if (boundaryCount[i] >= 6 && (pixel[i] == 0) == lightFinders && hasFinderProportions(boundaries[i])) {
+                            patterns.push_back(colPattern[i]);
+                        }
+                    }
+                    i++;
+                }
+            }
+            // the patterns of each column are found in ascending rows
+            std::stable_sort(patterns.begin(), patterns.end(), [](const QRColumnPattern& a, const QRColumnPattern & b) {
+                return a.col < b.col;
+            });
+        }
+
+        colPatterns.clear();
+        for (int band = 0; band < bandCount; band++) {
+            colPatterns.insert(colPatterns.end(), colBandPatterns[band].begin(), colBandPatterns[band].end());
         }
     }
 
@@ -202,7 +358,11 @@ namespace vernier {
         clearGroups();
         for (int row = 0; row < rowPatterns.size(); row++) {
             if (rowPatternGroup[row] < 0) { // row pattern not in a group
-                for (int col = 0; col < colPatterns.size(); col++) {
+                // the crossing column patterns have their column between xC and xD
+                int firstCol = std::upper_bound(colPatterns.begin(), colPatterns.end(), rowPatterns[row].xC, [](int x, const QRColumnPattern & pattern) {
+                    return x < pattern.col;
+                }) - colPatterns.begin();
+                for (int col = firstCol; col < colPatterns.size() && colPatterns[col].col < rowPatterns[row].xD; col++) {
                     if (colPatternGroup[col] < 0) { // col pattern not in a group
                         if (rowPatterns[row].isCrossing(colPatterns[col])) { // found a new group
                             int groupNumber = groupsOfColPatterns.size();
@@ -214,14 +374,18 @@ namespace vernier {
                             groupsOfRowPatterns[groupNumber].push_back(row);
 
                             // look for other crossing patterns
-                            for (int c = 0; c < colPatterns.size(); c++) {
+                            for (int c = firstCol; c < colPatterns.size() && colPatterns[c].col < rowPatterns[row].xD; c++) {
                                 if (colPatternGroup[c] < 0 && rowPatterns[row].isCrossing(colPatterns[c])) { // extending an existing group from row
                                     colPatternGroup[c] = groupNumber;
                                     groupsOfColPatterns[groupNumber].push_back(c);
                                 }
                             }
 
-                            for (int r = 0; r < rowPatterns.size(); r++) {
+                            // the crossing row patterns have their row between yC and yD
+                            int firstRow = std::upper_bound(rowPatterns.begin(), rowPatterns.end(), colPatterns[col].yC, [](int y, const QRRowPattern & pattern) {
+                                return y < pattern.row;
+                            }) - rowPatterns.begin();
+                            for (int r = firstRow; r < rowPatterns.size() && rowPatterns[r].row < colPatterns[col].yD; r++) {
                                 if (rowPatternGroup[r] < 0 && rowPatterns[r].isCrossing(colPatterns[col])) { // extending an existing group from col
                                     rowPatternGroup[r] = groupNumber;
                                     groupsOfRowPatterns[groupNumber].push_back(r);
@@ -284,13 +448,30 @@ namespace vernier {
             grayImage = image;
         }
 
-        cv::normalize(image, image, 255, 0, cv::NORM_MINMAX);
-        image.convertTo(grayImage, CV_8UC1);
-
-        //cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
-        cv::Canny(grayImage, cannyImage, lowCannyThreshold, highCannyThreshold, 3, true);
-        findRowPatterns();
-        findColPatterns();
+        if (runLengthScan) {
+            if (grayImage.depth() != CV_8U) {
+                cv::Mat normalizedImage;
+                cv::normalize(grayImage, normalizedImage, 255, 0, cv::NORM_MINMAX);
+                grayImage = cv::Mat();
+                normalizedImage.convertTo(grayImage, CV_8UC1);
+            }
+            cv::adaptiveThreshold(grayImage, binaryImage, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY, thresholdBlockSize, -thresholdOffset);
+            findRowRunPatterns();
+            findColRunPatterns();
+        } else {
+            // the image is normalized with all its channels as before, and
+            // converted into a new buffer since grayImage may share the data
+            // of the caller's image
+            cv::Mat normalizedImage;
+            cv::normalize(image, normalizedImage, 255, 0, cv::NORM_MINMAX);
+            grayImage = cv::Mat();
+            normalizedImage.convertTo(grayImage, CV_8UC1);
+
+            //cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+            cv::Canny(grayImage, cannyImage, lowCannyThreshold, highCannyThreshold, 3, true);
+            findRowPatterns();
+            findColPatterns();
+        }
         findGroupsOfPatterns();
         sortFiducials();
     }
@@ -18,6 +18,10 @@ namespace vernier {
         this->height = height;
     }
 
+    bool Rectangle::contains(double x, double y) const {
+        return x >= this->x && x < this->x + width && y >= this->y && y < this->y + height;
+    }
+
     std::string Rectangle::toString() {
         return "[" + vernier::to_string(x) + "; " + vernier::to_string(y) + "; " + vernier::to_string(width) + "; " + vernier::to_string(height) + "]";
 
@@ -186,37 +186,163 @@ namespace vernier {
         ASSERT_MSG(size > 0, "The size of the window must be positive.")
         Eigen::ArrayXXd window(size, size);
         int radius = size / 2;
-#pragma omp parallel for
-        for (int col = -radius; col < radius; col++) {
-            for (int row = -radius; row < radius; row++) {
-                double distanceToCenter = sqrt(row * row + col * col);
-                if (distanceToCenter < radius) {
-                    window(radius + row, radius + col) = (1 + cos(PI * pow(distanceToCenter, exposure) / pow(radius, exposure))) / 2;
+        for (int col = 0; col < size; col++) {
+            for (int row = 0; row < size; row++) {
+                double distanceToCenter = sqrt((row - radius) * (row - radius) + (col - radius) * (col - radius)) / radius;
+                if (distanceToCenter < 1.0) {
+                    double power = 1.0;
+                    for (int k = 0; k < exposure; k++) {
+                        power *= distanceToCenter;
+                    }
+                    window(row, col) = (1 + cos(PI * power)) / 2;
                 } else {
-                    window(radius + row, radius + col) = 0.0;
+                    window(row, col) = 0.0;
                 }
             }
         }
         return window;
     };
 
+    /** Intersects a square snapshot of the given size centered on (x, y) with
+     * the array. Returns false if the snapshot is partially outside the array.
+     */
+    static bool snapshotBounds(int x, int y, int size, const Eigen::ArrayXXd & array, int& row, int& col, int& rows, int& cols) {
+        int top = y - size / 2;
+        int left = x - size / 2;
+        row = std::max(top, 0);
+        col = std::max(left, 0);
+        rows = std::min(top + size, (int) array.rows()) - row;
+        cols = std::min(left + size, (int) array.cols()) - col;
+        return (rows == size && cols == size);
+    }
+
     void takeSnapshot(int x, int y, int size, const Eigen::ArrayXXd & array, Eigen::ArrayXXd & snapshot) {
         snapshot.resize(size, size);
-        int radius = size / 2;
-#pragma omp parallel for
-        for (int col = -radius; col < radius; col++) {
-            for (int row = -radius; row < radius; row++) {
-                if (y + row >= 0 && y + row < array.rows() && x + col >= 0 && x + col < array.cols()) {
-                    snapshot(radius + row, radius + col) = array(y + row, x + col);
-                } else {
-                    snapshot(radius + row, radius + col) = 0.0;
-                }
+        int row, col, rows, cols;
+        if (snapshotBounds(x, y, size, array, row, col, rows, cols)) {
+            snapshot = array.block(row, col, size, size);
+        } else {
+            snapshot.setZero();
+            if (rows > 0 && cols > 0) {
+                int offset = size / 2;
+                snapshot.block(row - y + offset, col - x + offset, rows, cols) = array.block(row, col, rows, cols);
+            }
+        }
+    }
 
+    void takeWindowedSnapshot(int x, int y, const Eigen::ArrayXXd & array, const Eigen::ArrayXXd & window, Eigen::ArrayXXcd & snapshot) {
+        int size = window.rows();
+        snapshot.resize(size, size);
+        int row, col, rows, cols;
+        if (snapshotBounds(x, y, size, array, row, col, rows, cols)) {
+            snapshot = (array.block(row, col, size, size) * window).cast<std::complex<double> >();
+        } else {
+            snapshot.setZero();
+            if (rows > 0 && cols > 0) {
+                int offset = size / 2;
+                int snapshotRow = row - y + offset;
+                int snapshotCol = col - x + offset;
+                snapshot.block(snapshotRow, snapshotCol, rows, cols) = (array.block(row, col, rows, cols) * window.block(snapshotRow, snapshotCol, rows, cols)).cast<std::complex<double> >();
+            }
+        }
+    }
+
+    UniformGrid::UniformGrid() {
+        build(std::vector<Rectangle>(), 1.0, 1.0);
+    }
+
+    void UniformGrid::build(const std::vector<Rectangle>& items, double minCellSize, double cellsPerItem) {
+        if (items.empty()) {
+            // empty grid which contains no point
+            left = top = 0.0;
+            right = bottom = -1.0;
+            cellSize = 1.0;
+            cols = rows = 1;
+            cellStarts = {0, 0};
+            cellItems.clear();
+            return;
+        }
+        left = items[0].x;
+        top = items[0].y;
+        right = items[0].x + items[0].width;
+        bottom = items[0].y + items[0].height;
+        for (int i = 1; i < items.size(); i++) {
+            left = std::min(left, items[i].x);
+            top = std::min(top, items[i].y);
+            right = std::max(right, items[i].x + items[i].width);
+            bottom = std::max(bottom, items[i].y + items[i].height);
+        }
+        double extent = std::max(right - left, bottom - top);
+        cellSize = std::max(minCellSize, extent / std::sqrt(cellsPerItem * items.size()));
+        if (!(cellSize > 0.0)) {
+            cellSize = 1.0;
+        }
+        cols = getCol(right) + 1;
+        rows = getRow(bottom) + 1;
+
+        // counting sort in two passes: the items are counted per cell, then 
+        // stored at the cursors of the cells
+        cellStarts.assign(cols * rows + 1, 0);
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 1) {
+                for (int cell = 0; cell < cols * rows; cell++) {
+                    cellStarts[cell + 1] += cellStarts[cell];
+                }
+                cellItems.resize(cellStarts[cols * rows]);
+            }
+            std::vector<int> cursors(cellStarts.begin(), cellStarts.end() - 1);
+            for (int i = 0; i < items.size(); i++) {
+                int colStart = std::max(getCol(items[i].x), 0);
+                int colStop = std::min(getCol(items[i].x + items[i].width), cols - 1);
+                int rowStart = std::max(getRow(items[i].y), 0);
+                int rowStop = std::min(getRow(items[i].y + items[i].height), rows - 1);
+                for (int row = rowStart; row <= rowStop; row++) {
+                    for (int col = colStart; col <= colStop; col++) {
+                        if (pass == 0) {
+                            cellStarts[row * cols + col + 1]++;
+                        } else {
+                            cellItems[cursors[row * cols + col]++] = i;
+                        }
+                    }
+                }
             }
         }
     }
 
+    void UniformGrid::build(const std::vector<cv::Point2d>& items, double minCellSize, double cellsPerItem) {
+        std::vector<Rectangle> rectangles(items.size());
+        for (int i = 0; i < items.size(); i++) {
+            rectangles[i] = Rectangle(items[i].x, items[i].y, 0.0, 0.0);
+        }
+        build(rectangles, minCellSize, cellsPerItem);
+    }
+
+    int UniformGrid::getCol(double x) const {
+        return (int) std::floor((x - left) / cellSize);
+    }
+
+    int UniformGrid::getRow(double y) const {
+        return (int) std::floor((y - top) / cellSize);
+    }
 
+    int UniformGrid::getCell(double x, double y) const {
+        if (!(x >= left && y >= top && x <= right && y <= bottom)) {
+            return -1;
+        }
+        return std::min(getRow(y), rows - 1) * cols + std::min(getCol(x), cols - 1);
+    }
 
+    void UniformGrid::findItems(const Rectangle& region, std::vector<int>& items) const {
+        int colStart = std::max(getCol(region.x), 0);
+        int colStop = std::min(getCol(region.x + region.width), cols - 1);
+        int rowStart = std::max(getRow(region.y), 0);
+        int rowStop = std::min(getRow(region.y + region.height), rows - 1);
+        for (int row = rowStart; row <= rowStop; row++) {
+            for (int col = colStart; col <= colStop; col++) {
+                int cell = row * cols + col;
+                items.insert(items.end(), cellItems.begin() + cellStarts[cell], cellItems.begin() + cellStarts[cell + 1]);
+            }
+        }
+    }
 
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
  */
 
 #include "SquareDetector.hpp"
+#include "Spatial.hpp"
 
 namespace vernier {
 
@@ -84,13 +85,108 @@ namespace vernier {
     }
 
     /**
-     * @brief Threshold input image using adaptive thresholding
+     * @brief Threshold input image using adaptive thresholding. The local means are read in
+     * the integral image of the input padded by replication, which is shared by all the window
+     * sizes (equivalent to adaptiveThreshold with ADAPTIVE_THRESH_MEAN_C and THRESH_BINARY_INV)
      */
-    static void _threshold(InputArray _in, OutputArray _out, int winSize, double constant) {
+    static void _threshold(const Mat &in, const Mat &integralImage, int padding, Mat &out, int winSize, double constant) {
 
         CV_Assert(winSize >= 3);
         if (winSize % 2 == 0) winSize++; // win size must be odd
-        adaptiveThreshold(_in, _out, 255, ADAPTIVE_THRESH_MEAN_C, THRESH_BINARY_INV, winSize, constant);
+        int halfSize = winSize / 2;
+        CV_Assert(halfSize <= padding);
+        unsigned int area = (unsigned int) (winSize * winSize);
+        int delta = cvFloor(constant);
+
+        out.create(in.size(), CV_8UC1);
+        for (int y = 0; y < in.rows; y++) {
+            const unsigned int* top = integralImage.ptr<unsigned int>(y + padding - halfSize);
+            const unsigned int* bottom = integralImage.ptr<unsigned int>(y + padding + halfSize + 1);
+            const uchar* grey = in.ptr<uchar>(y);
+            uchar* thresh = out.ptr<uchar>(y);
+            for (int x = 0; x < in.cols; x++) {
+                int left = x + padding - halfSize;
+                int right = x + padding + halfSize + 1;
+                // the window sums are exact even if the integral image overflows (modulo 2^32)
+                unsigned int sum = bottom[right] - bottom[left] - top[right] + top[left];
+                int mean = (int) ((2 * sum + area) / (2 * area)); // rounded mean (area is odd)
+                thresh[x] = (grey[x] - mean <= -delta) ? 255 : 0;
+            }
+        }
+    }
+
+    static Point2f _getCenter(const vector<Point2f> &corners) {
+        return (corners[0] + corners[1] + corners[2] + corners[3]) * 0.25f;
+    }
+
+    static float _getPerimeter(const vector<Point2f> &corners) {
+        float perimeter = 0.f;
+        for (size_t i = 0ull; i < 4ull; i++) {
+            perimeter += sqrt(normL2Sqr<float>(Point2f(corners[i] - corners[(i + 1ull) % 4ull])));
+        }
+        return perimeter;
+    }
+
+    // returns the average distance between the marker points
+
+    float static inline getAverageDistance(const std::vector<Point2f>& marker1, const std::vector<Point2f>& marker2) {
+        float minDistSq = std::numeric_limits<float>::max();
+        // fc is the first corner considered on one of the markers, 4 combinations are possible
+        for (int fc = 0; fc < 4; fc++) {
+            float distSq = 0;
+            for (int c = 0; c < 4; c++) {
+                // modC is the corner considering first corner is fc
+                int modC = (c + fc) % 4;
+                distSq += normL2Sqr<float>(marker1[modC] - marker2[c]);
+            }
+            distSq /= 4.f;
+            minDistSq = min(minDistSq, distSq);
+        }
+        return sqrt(minDistSq);
+    }
+
+    /**
+     * @brief Builds the uniform grid of the candidate centers, used to find the close candidates
+     * without comparing all the pairs. The average distance between the corners of two candidates
+     * is never smaller than the distance between their centers.
+     */
+    static void _buildCenterGrid(const vector<Point2f> &centers, float cellSize, UniformGrid &grid) {
+        // no more than a few cells per candidate
+        grid.build(vector<Point2d>(centers.begin(), centers.end()), max((double) cellSize, 1.0), 4.0);
+    }
+
+    /// appends the candidates whose center is in a cell closer than radius to the point (unsorted)
+    static void _findNeighbours(const UniformGrid &grid, Point2f point, float radius, vector<int> &neighbours) {
+        grid.findItems(Rectangle(point.x - radius, point.y - radius, 2 * radius, 2 * radius), neighbours);
+    }
+
+    /**
+     * @brief Returns true if the candidates found at two thresholding scales are the same
+     * (same number and each candidate close to one of the other scale)
+     */
+    static bool _isStable(const vector<vector<Point2f> > &candidates, const vector<vector<Point2f> > &previousCandidates,
+            double minMarkerDistanceRate) {
+
+        if (candidates.empty() || candidates.size() != previousCandidates.size()) return false;
+
+        vector<Point2f> previousCenters(previousCandidates.size());
+        for (size_t i = 0ull; i < previousCandidates.size(); i++) {
+            previousCenters[i] = _getCenter(previousCandidates[i]);
+        }
+        UniformGrid grid;
+        _buildCenterGrid(previousCenters, 0.f, grid);
+        vector<int> neighbours;
+        for (size_t i = 0ull; i < candidates.size(); i++) {
+            float maxDistance = _getPerimeter(candidates[i]) * (float) minMarkerDistanceRate;
+            neighbours.clear();
+            _findNeighbours(grid, _getCenter(candidates[i]), maxDistance + 1.f, neighbours);
+            bool found = false;
+            for (size_t k = 0ull; k < neighbours.size() && !found; k++) {
+                found = getAverageDistance(candidates[i], previousCandidates[neighbours[k]]) < maxDistance;
+            }
+            if (!found) return false;
+        }
+        return true;
     }
 
     /**
@@ -108,27 +204,45 @@ namespace vernier {
         int nScales = (params.adaptiveThreshWinSizeMax - params.adaptiveThreshWinSizeMin) /
                 params.adaptiveThreshWinSizeStep + 1;
 
+        // integral image padded for the largest window, shared by all the scales
+        int padding = (params.adaptiveThreshWinSizeMin + (nScales - 1) * params.adaptiveThreshWinSizeStep) / 2;
+        Mat padded, integralImage;
+        copyMakeBorder(grey, padded, padding, padding, padding, padding, BORDER_REPLICATE | BORDER_ISOLATED);
+        integral(padded, integralImage, CV_32S);
+
         vector<vector<vector<Point2f> > > candidatesArrays((size_t) nScales);
         vector<vector<vector<Point> > > contoursArrays((size_t) nScales);
 
-        ////for each value in the interval of thresholding window sizes
-        parallel_for_(Range(0, nScales), [&](const Range & range) {
-            const int begin = range.start;
-            const int end = range.end;
-
-            for (int i = begin; i < end; i++) {
-                int currScale = params.adaptiveThreshWinSizeMin + i * params.adaptiveThreshWinSizeStep;
-                        // threshold
-                        Mat thresh;
-                        _threshold(grey, thresh, currScale, params.adaptiveThreshConstant);
-
-                        // detect rectangles
-                        _findMarkerContours(thresh, candidatesArrays[i], contoursArrays[i],
-                        params.minMarkerPerimeterRate, params.maxMarkerPerimeterRate,
-                        params.polygonalApproxAccuracyRate, params.minCornerDistanceRate,
-                        params.minDistanceToBorder, params.minSideLengthCanonicalImg);
+        auto detectScale = [&](int i) {
+            int currScale = params.adaptiveThreshWinSizeMin + i * params.adaptiveThreshWinSizeStep;
+            // threshold
+            Mat thresh;
+            _threshold(grey, integralImage, padding, thresh, currScale, params.adaptiveThreshConstant);
+
+            // detect rectangles
+            _findMarkerContours(thresh, candidatesArrays[i], contoursArrays[i],
+                    params.minMarkerPerimeterRate, params.maxMarkerPerimeterRate,
+                    params.polygonalApproxAccuracyRate, params.minCornerDistanceRate,
+                    params.minDistanceToBorder, params.minSideLengthCanonicalImg);
+        };
+
+        if (params.stopOnStableCandidates) {
+            // scales in increasing order until two consecutive scales give the same candidates
+            for (int i = 0; i < nScales; i++) {
+                detectScale(i);
+                if (i > 0 && _isStable(candidatesArrays[i], candidatesArrays[i - 1], params.minMarkerDistanceRate)) {
+                    nScales = i + 1;
+                    break;
+                }
             }
-        });
+        } else {
+            ////for each value in the interval of thresholding window sizes
+            parallel_for_(Range(0, nScales), [&](const Range & range) {
+                for (int i = range.start; i < range.end; i++) {
+                    detectScale(i);
+                }
+            });
+        }
         // join candidates
         for (int i = 0; i < nScales; i++) {
             for (unsigned int j = 0; j < candidatesArrays[i].size(); j++) {
@@ -188,10 +302,7 @@ namespace vernier {
         MarkerCandidateTree(vector<Point2f>&& corners_, vector<Point>&& contour_) {
             corners = std::move(corners_);
             contour = std::move(contour_);
-            perimeter = 0.f;
-            for (size_t i = 0ull; i < 4ull; i++) {
-                perimeter += sqrt(normL2Sqr<float>(Point2f(corners[i] - corners[(i + 1ull) % 4ull])));
-            }
+            perimeter = _getPerimeter(corners);
         }
 
         bool operator<(const MarkerCandidateTree& m) const {
@@ -200,24 +311,6 @@ namespace vernier {
         }
     };
 
-    // returns the average distance between the marker points
-
-    float static inline getAverageDistance(const std::vector<Point2f>& marker1, const std::vector<Point2f>& marker2) {
-        float minDistSq = std::numeric_limits<float>::max();
-        // fc is the first corner considered on one of the markers, 4 combinations are possible
-        for (int fc = 0; fc < 4; fc++) {
-            float distSq = 0;
-            for (int c = 0; c < 4; c++) {
-                // modC is the corner considering first corner is fc
-                int modC = (c + fc) % 4;
-                distSq += normL2Sqr<float>(marker1[modC] - marker2[c]);
-            }
-            distSq /= 4.f;
-            minDistSq = min(minDistSq, distSq);
-        }
-        return sqrt(minDistSq);
-    }
-
     struct ArucoDetectorImpl {
         /// dictionary indicates the type of markers that will be searched
         //Dictionary dictionary;
@@ -272,9 +365,32 @@ namespace vernier {
             vector<vector<size_t> > groupedCandidates;
             vector<bool> isSelectedContours(candidateTree.size(), true);
 
+            // grid of the centers with cells of about the grouping distance of a median candidate
+            vector<Point2f> centers(candidateTree.size());
+            vector<float> perimeters(candidateTree.size());
+            for (size_t i = 0ull; i < candidateTree.size(); i++) {
+                centers[i] = _getCenter(candidateTree[i].corners);
+                perimeters[i] = candidateTree[i].perimeter;
+            }
+            float medianPerimeter = 0.f;
+            if (!perimeters.empty()) {
+                nth_element(perimeters.begin(), perimeters.begin() + perimeters.size() / 2, perimeters.end());
+                medianPerimeter = perimeters[perimeters.size() / 2];
+            }
+            UniformGrid grid;
+            _buildCenterGrid(centers, medianPerimeter * (float) detectorParams.minMarkerDistanceRate, grid);
+            vector<int> neighbours;
+
             size_t countSelectedContours = 0ull;
             for (size_t i = 0ull; i < candidateTree.size(); i++) {
-                for (size_t j = i + 1ull; j < candidateTree.size(); j++) {
+                // the next candidates are not larger than i, so they can only be grouped with i if
+                // their center is closer than the grouping distance of i (1 pixel margin for rounding)
+                neighbours.clear();
+                _findNeighbours(grid, centers[i], candidateTree[i].perimeter * (float) detectorParams.minMarkerDistanceRate + 1.f, neighbours);
+                std::sort(neighbours.begin(), neighbours.end());
+                for (size_t k = 0ull; k < neighbours.size(); k++) {
+                    size_t j = (size_t) neighbours[k];
+                    if (j <= i) continue;
                     float minDist = getAverageDistance(candidateTree[i].corners, candidateTree[j].corners);
                     // if mean distance is too low, group markers
                     // the distance between the points of two independent markers should be more than half the side of the marker
@@ -415,10 +531,10 @@ namespace vernier {
 
     SquareDetector::SquareDetector() {
         parameters = SquareDetectorParameters();
-        
+        tracked = false;
     }
 
-    void SquareDetector::compute(const cv::Mat& image) {
+    void SquareDetector::detect(const cv::Mat& image, cv::Point2f offset) {
         //arucoDetectorImpl = cv::makePtr<ArucoDetectorImpl>(cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250), parameters, cv::aruco::RefineParameters());
         //Ptr<ArucoDetectorImpl> arucoDetectorImpl = cv::makePtr<ArucoDetectorImpl>(parameters);
         ArucoDetectorImpl arucoDetectorImpl = ArucoDetectorImpl(parameters);
@@ -430,15 +546,56 @@ namespace vernier {
         std::vector<MarkerCandidateTree> selectedCandidates;
         selectedCandidates = arucoDetectorImpl.filterTooCloseCandidates(candidates, contours);
 
-        squares.clear();
         for (int i = 0; i < selectedCandidates.size(); i++) {
             if (selectedCandidates[i].parent < 0) {
-                Square s(selectedCandidates[i].corners);
+                Square s(selectedCandidates[i].corners[0] + offset, selectedCandidates[i].corners[1] + offset,
+                        selectedCandidates[i].corners[2] + offset, selectedCandidates[i].corners[3] + offset);
                 squares.push_back(s);
             }
         }
     }
 
+    void SquareDetector::compute(const cv::Mat& image) {
+        std::vector<cv::Rect> regions = tracker.getRegions(image.size());
+        std::vector<cv::Point2d> centers;
+        std::vector<double> radii;
+
+        tracked = false;
+        if (!regions.empty()) {
+            squares.clear();
+            for (int i = 0; i < regions.size(); i++) {
+                detect(image(regions[i]), cv::Point2f((float) regions[i].x, (float) regions[i].y));
+            }
+            for (int i = 0; i < squares.size(); i++) {
+                centers.push_back(squares[i].getCenter());
+                radii.push_back(squares[i].getRadius());
+            }
+            tracked = tracker.update(centers, radii, false);
+        }
+
+        if (!tracked) {
+            squares.clear();
+            detect(image, cv::Point2f(0.f, 0.f));
+            centers.clear();
+            radii.clear();
+            for (int i = 0; i < squares.size(); i++) {
+                centers.push_back(squares[i].getCenter());
+                radii.push_back(squares[i].getRadius());
+            }
+            tracker.update(centers, radii, true);
+        }
+    }
+
+    void SquareDetector::setTrackingMode(bool trackingMode) {
+        tracker.trackingMode = trackingMode;
+        tracker.reset();
+        tracked = false;
+    }
+
+    bool SquareDetector::isTracked() {
+        return tracked;
+    }
+
     void SquareDetector::draw(cv::Mat& image) {
         for (int i = 0; i < squares.size(); i++) {
             squares[i].draw(image);
@@ -6,12 +6,18 @@
 
 #include "StampPatternDetector.hpp"
 #include "Spatial.hpp"
+#include <algorithm>
+#include <functional>
 
 namespace vernier {
 
     StampPatternDetector::StampPatternDetector()
     : BitmapPatternDetector() {
         classname = "StampPattern";
+        snapshotSize = 0;
+        maxCandidates = 8;
+        shortlistedCount = 0;
+        minCorrelation = 0.96;
     }
 
     StampPatternDetector::StampPatternDetector(double physicalPeriod, const std::string & filename, int snapshotSize)
@@ -19,10 +25,15 @@ namespace vernier {
         classname = "StampPattern";
         ASSERT_MSG(bitmap[0].cols == bitmap[0].rows, "The stamp bitmap must be square");
         ASSERT_MSG(bitmap[0].cols % 2 == 1, "The size of the stamp bitmap must be odd");
-        snapshot.resize(snapshotSize, snapshotSize);
+        this->snapshotSize = snapshotSize;
         window = hannWindow(snapshotSize, 4);
         bitmapThumbnail.resize(bitmap[0].cols - 8);
-        patternPhase.resize(snapshotSize, snapshotSize);
+        maxCandidates = 8;
+        shortlistedCount = 0;
+        minCorrelation = 0.96;
+        for (int k = 0; k < 4; k++) {
+            indexBitmap(k);
+        }
     }
 
     void StampPatternDetector::addBitmap(const std::string & filename) {
@@ -37,6 +48,70 @@ namespace vernier {
             bitmap.push_back(cv::Mat());
             cv::rotate(bitmap[bitmap.size() - 2], bitmap[bitmap.size() - 1], cv::ROTATE_90_CLOCKWISE);
         }
+        for (int k = bitmap.size() - 4; k < bitmap.size(); k++) {
+            indexBitmap(k);
+        }
+    }
+
+    unsigned int StampPatternDetector::getLocalPattern(const cv::Mat& binaryImage, int row, int col) {
+        unsigned int pattern = 0;
+        for (int i = row - 2; i <= row + 2; i++) {
+            const unsigned char* line = binaryImage.ptr<unsigned char>(i);
+            for (int j = col - 2; j <= col + 2; j++) {
+                pattern = (pattern << 1) | (line[j] > 127);
+            }
+        }
+        return pattern;
+    }
+
+    template <typename Function>
+    void StampPatternDetector::forEachLocalPattern(const cv::Mat& binaryImage, int dotOffset, Function function) {
+        for (int row = 2; row < binaryImage.rows - 2; row++) {
+            const unsigned char* line = binaryImage.ptr<unsigned char>(row);
+            bool dotRow = (row - dotOffset) % 2 == 0;
+            for (int col = 2; col < binaryImage.cols - 2; col++) {
+                if (line[col] > 127 && !(dotRow && (col - dotOffset) % 2 == 0)) {
+                    function(getLocalPattern(binaryImage, row, col));
+                }
+            }
+        }
+    }
+
+    void StampPatternDetector::indexBitmap(int k) {
+        forEachLocalPattern(bitmap[k], 0, [this, k](unsigned int pattern) {
+            std::vector<int>& bitmaps = patternIndex[pattern];
+            if (bitmaps.empty() || bitmaps.back() != k) {
+                bitmaps.push_back(k);
+            }
+        });
+    }
+
+    void StampPatternDetector::findCandidates() {
+        // patterns found in more than twice as many bitmaps as the shortlist 
+        // holds do not discriminate the stamps and would make the vote grow 
+        // with their number
+        const cv::Mat& binaryThumbnail = bitmapThumbnail.binaryThumbnail;
+        votes.clear();
+        forEachLocalPattern(binaryThumbnail, binaryThumbnail.rows / 2, [this](unsigned int pattern) {
+            std::unordered_map<unsigned int, std::vector<int> >::const_iterator it = patternIndex.find(pattern);
+            if (it != patternIndex.end() && (int) it->second.size() <= 2 * maxCandidates) {
+                double weight = 1.0 / it->second.size();
+                for (int k : it->second) {
+                    votes[k] += weight;
+                }
+            }
+        });
+
+        std::vector<std::pair<double, int> > ranking;
+        for (const std::pair<const int, double>& vote : votes) {
+            ranking.push_back(std::make_pair(vote.second, vote.first));
+        }
+        std::sort(ranking.begin(), ranking.end(), std::greater<std::pair<double, int> >());
+
+        candidates.clear();
+        for (int i = 0; i < ranking.size() && i < maxCandidates && ranking[i].first >= 0.5 * ranking[0].first; i++) {
+            candidates.push_back(ranking[i].second);
+        }
     }
 
     void StampPatternDetector::readJSON(const rapidjson::Value& document) {
@@ -47,46 +122,89 @@ namespace vernier {
         
         detector.compute(image8U);
 
+        int squareCount = detector.squares.size();
+        MarkerWorker::createWorkers(workers, snapshotSize);
+        while (thumbnails.size() < squareCount) {
+            thumbnails.push_back(BitmapThumbnail(bitmapThumbnail.size()));
+        }
+        squarePlanes1.resize(squareCount);
+        squarePlanes2.resize(squareCount);
+        squarePeaksFound.assign(squareCount, 0);
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < squareCount; i++) {
+
+            Square& square = detector.squares[i];
+            int diameter = (int) (2 * square.getRadius());
+            if (diameter >= 2 * bitmapThumbnail.size()) {
+
+                int centerX = (int) square.getCenter().x;
+                int centerY = (int) square.getCenter().y;
+                MarkerWorker& worker = *workers[MarkerWorker::getThreadIndex()];
+                if (worker.compute(array, centerX, centerY, window)) {
+                    squarePlanes1[i] = worker.patternPhase.getPlane1();
+                    squarePlanes2[i] = worker.patternPhase.getPlane2();
+                    worker.takeSnapshot(array, centerX, centerY);
+                    thumbnails[i].compute(worker.snapshot, squarePlanes1[i], squarePlanes2[i]);
+                    squarePeaksFound[i] = 1;
+                }
+            }
+        }
+
+        // the bitmaps are matched in the order of the squares, so that the 
+        // markers are the same as with a serial processing
         markers.clear();
-        for (int i = 0; i < detector.squares.size(); i++) {
+        shortlistedCount = 0;
+        for (int i = 0; i < squareCount; i++) {
 
-            Square square = detector.squares[i];
+            Square& square = detector.squares[i];
             int diameter = (int) (2 * square.getRadius());
-            if (snapshot.cols() < diameter) {
+            if (snapshotSize < diameter) {
                 std::cout << "The stamp is too large for pose estimation: increase the snapshot size over " << diameter << " pixels." << std::endl;
             }
-            if (diameter < 2 * bitmapThumbnail.size()) {
-                //std::cout << "The stamp is too tiny for pose estimation: increase the picture quality size." << std::endl;
-            } else {
+
+            if (squarePeaksFound[i]) {
 
                 int centerX = (int) square.getCenter().x;
                 int centerY = (int) square.getCenter().y;
-                takeSnapshot(centerX, centerY, snapshot.cols(), array, snapshot);
-
-                patternPhase.compute(snapshot * window);
-                plane1 = patternPhase.getPlane1();
-                plane2 = patternPhase.getPlane2();
-
-                if (patternPhase.peaksFound()) {
+                plane1 = squarePlanes1[i];
+                plane2 = squarePlanes2[i];
+                std::swap(bitmapThumbnail, thumbnails[i]);
 
-                    bitmapThumbnail.compute(snapshot.real(), patternPhase.getPlane1(), patternPhase.getPlane2());
+                if (maxCandidates > 0 && bitmap.size() > maxCandidates) {
+                    findCandidates();
+                } else {
+                    candidates.clear();
+                }
+                if (candidates.empty()) {
                     computeAbsolutePose();
+                } else {
+                    computeAbsolutePose(candidates);
+                    if (bitmapCorrelation < minCorrelation) {
+                        // the shortlist may have missed the stamp: all the 
+                        // bitmaps are matched with the planes of the square
+                        plane1 = squarePlanes1[i];
+                        plane2 = squarePlanes2[i];
+                        computeAbsolutePose();
+                    } else {
+                        shortlistedCount++;
+                    }
+                }
 
-                    double dx = -plane1.getPosition(physicalPeriod, 0.0, 0.0, periodShift1);
-                    double dy = -plane2.getPosition(physicalPeriod, 0.0, 0.0, periodShift2);
-                    double alpha = plane1.getAngle();
+                double dx = -plane1.getPosition(physicalPeriod, 0.0, 0.0, periodShift1);
+                double dy = -plane2.getPosition(physicalPeriod, 0.0, 0.0, periodShift2);
+                double alpha = plane1.getAngle();
 
-                    double pixelSize = physicalPeriod / plane1.getPixelicPeriod();
-                    double xImg = (centerX - this->image64F.cols/2);
-                    double yImg = (centerY - this->image64F.rows/2);
-                    double x = pixelSize * (xImg * cos(alpha) - yImg * sin(-alpha)) + dx;
-                    double y = pixelSize * (xImg * sin(-alpha) + yImg * cos(alpha)) + dy;
+                double pixelSize = physicalPeriod / plane1.getPixelicPeriod();
+                double xImg = (centerX - this->image64F.cols/2);
+                double yImg = (centerY - this->image64F.rows/2);
+                double x = pixelSize * (xImg * cos(alpha) - yImg * sin(-alpha)) + dx;
+                double y = pixelSize * (xImg * sin(-alpha) + yImg * cos(alpha)) + dy;
 
-                    Pose pose = Pose(x, y, 0.0, alpha, 0.0, 0.0, pixelSize);
+                Pose pose = Pose(x, y, 0.0, alpha, 0.0, 0.0, pixelSize);
 
-                    int id = bitmapIndex / 4;
-                    markers.insert(std::make_pair(id, pose));
-                }
+                int id = bitmapIndex / 4;
+                markers.insert(std::make_pair(id, pose));
             }
         }
     }
@@ -122,15 +240,69 @@ namespace vernier {
     }
 
     void StampPatternDetector::showControlImages() {
-        patternPhase.showControlImages();
+        if (!workers.empty()) {
+            workers[0]->patternPhase.showControlImages();
+        }
         bitmapThumbnail.showControlImages();
     }
 
+    void StampPatternDetector::setInt(const std::string & attribute, int value) {
+        if (attribute == "maxCandidates") {
+            maxCandidates = value;
+        } else {
+            BitmapPatternDetector::setInt(attribute, value);
+        }
+    }
+
+    int StampPatternDetector::getInt(const std::string & attribute) {
+        if (attribute == "maxCandidates") {
+            return maxCandidates;
+        } else if (attribute == "shortlistedCount") {
+            return shortlistedCount;
+        } else {
+            return BitmapPatternDetector::getInt(attribute);
+        }
+    }
+
+    void StampPatternDetector::setDouble(const std::string & attribute, double value) {
+        if (attribute == "minCorrelation") {
+            minCorrelation = value;
+        } else {
+            BitmapPatternDetector::setDouble(attribute, value);
+        }
+    }
+
+    double StampPatternDetector::getDouble(const std::string & attribute) {
+        if (attribute == "minCorrelation") {
+            return minCorrelation;
+        } else {
+            return BitmapPatternDetector::getDouble(attribute);
+        }
+    }
+
+    void StampPatternDetector::setBool(const std::string & attribute, bool value) {
+        if (attribute == "trackingMode") {
+            detector.setTrackingMode(value);
+        } else {
+            BitmapPatternDetector::setBool(attribute, value);
+        }
+    }
+
+    bool StampPatternDetector::getBool(const std::string & attribute) {
+        if (attribute == "trackingMode") {
+            return detector.tracker.trackingMode;
+        } else if (attribute == "tracked") {
+            return detector.isTracked();
+        } else {
+            return BitmapPatternDetector::getBool(attribute);
+        }
+    }
+
     void StampPatternDetector::draw(cv::Mat & image) {
         PatternDetector::draw(image);
         detector.draw(image);
         for (std::map<int, Pose>::iterator it = markers.begin(); it != markers.end(); it++) {
-            it->second.draw(image, snapshot.cols() / 2, to_string(it->first));
+            it->second.draw(image, snapshotSize / 2, to_string(it->first));
         }
     }
 
@@ -7,6 +7,7 @@
 #include "Vernier.hpp"
 #include "UnitTest.hpp"
 #include "MegarenaAbsoluteDecoding.hpp"
+#include "MegarenaBitSequence.hpp"
 #include <random>
 #include "eigen-matio/MatioFile.hpp"
 
@@ -52,6 +53,41 @@ void runAllTests() {
     //std::cout << "max index of correlation at : " << maxIndex << "th position" << std::endl;
 
     UNIT_TEST(maxIndex == 7);
+
+    MegarenaPackedSequence packedSequence;
+    MegarenaBitSequence::generate(10, packedSequence);
+    MegarenaAbsoluteDecoding packedDecode(packedSequence);
+    std::mt19937 generator(12);
+    for (int i = 0; i < 10; i++) {
+        int codeLength = std::uniform_int_distribution<int>(90, 200)(generator);
+        int codePosition = std::uniform_int_distribution<int>(0, packedSequence.size() - codeLength)(generator);
+        Eigen::ArrayXXd codeSample = Eigen::ArrayXXd::Zero(codeLength, 1);
+        for (int j = 0; j < codeLength; j++) {
+            if ((codePosition + j) % 3 == 1) {
+                codeSample(j, 0) = packedSequence.get(codePosition + j) ? 1 : -1;
+            }
+        }
+        // one wrong bit must not change the decoded position
+        int wrongBit = 3 * std::uniform_int_distribution<int>(0, codeLength / 3 - 1)(generator) + (1 - codePosition % 3 + 3) % 3;
+        codeSample(wrongBit, 0) = -codeSample(wrongBit, 0);
+
+        UNIT_TEST(packedDecode.findCodePosition(codeSample, 1) - codeLength / 2 == codePosition);
+    }
+
+    // wafer-scale code: the candidates are found with the window table
+    MegarenaBitSequence::generate(16, packedSequence);
+    packedDecode.resize(packedSequence);
+    for (int i = 0; i < 10; i++) {
+        int codeLength = std::uniform_int_distribution<int>(90, 200)(generator);
+        int codePosition = std::uniform_int_distribution<int>(0, packedSequence.size() - codeLength)(generator);
+        Eigen::ArrayXXd codeSample = Eigen::ArrayXXd::Zero(codeLength, 1);
+        for (int j = 0; j < codeLength; j++) {
+            if ((codePosition + j) % 3 == 1) {
+                codeSample(j, 0) = packedSequence.get(codePosition + j) ? 1 : -1;
+            }
+        }
+        UNIT_TEST(packedDecode.findCodePosition(codeSample, 1) - codeLength / 2 == codePosition);
+    }
 }
 
 void test12bits() {
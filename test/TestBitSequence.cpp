@@ -2743,6 +2743,21 @@ void runAllTests() {
         UNIT_TEST(MegarenaBitSequence::check(bitDepth, bitSequenceB));
     }
 
+    MegarenaPackedSequence packedSequence;
+    for (int bitDepth = 4; bitDepth <= 12; bitDepth++) {
+        MegarenaBitSequence::generate(bitDepth, bitSequenceB);
+        MegarenaBitSequence::generate(bitDepth, packedSequence);
+        bitSequenceA = packedSequence.toArray();
+        UNIT_TEST(areEqual(bitSequenceA, bitSequenceB));
+    }
+
+    for (int bitDepth = 13; bitDepth <= MegarenaBitSequence::MAX_CODE_DEPTH; bitDepth++) {
+        MegarenaBitSequence::generate(bitDepth, packedSequence);
+        bitSequenceA = packedSequence.toArray();
+        UNIT_TEST(MegarenaBitSequence::check(bitDepth, bitSequenceA));
+        UNIT_TEST(MegarenaBitSequence::codeDepth(packedSequence.size()) == bitDepth);
+    }
+
 }
 
 
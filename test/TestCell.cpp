@@ -50,6 +50,19 @@ void runAllTests() {
             200.396, 180.896, 198.432;
 
     UNIT_TEST(areEqual(globalCellRef, globalCellTest, 0.001));
+
+    // same global cell from the sums of the thumbnail grouped by indexes modulo 3
+    Eigen::Array33d groupNumberWhiteDots = Eigen::Array33d::Zero();
+    Eigen::Array33d groupCumulWhiteDots = Eigen::Array33d::Zero();
+    for (int col = 0; col < numberWhiteDots.cols(); col++) {
+        for (int row = 0; row < numberWhiteDots.rows(); row++) {
+            groupNumberWhiteDots(row % 3, col % 3) += numberWhiteDots(row, col);
+            groupCumulWhiteDots(row % 3, col % 3) += cumulWhiteDots(row, col);
+        }
+    }
+    cell.setGlobalCell(groupNumberWhiteDots, groupCumulWhiteDots);
+
+    UNIT_TEST(areEqual(globalCellRef, cell.getGlobalCellOut(), 0.001));
 }
 
 double speedGlobal(unsigned long testCount) {
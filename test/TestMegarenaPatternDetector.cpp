@@ -6,12 +6,40 @@
 
 #include "Vernier.hpp"
 #include "UnitTest.hpp"
+#include <atomic>
 
 using namespace vernier;
 using namespace cv;
 using namespace std;
 using namespace Eigen;
 
+#ifdef __GLIBC__
+// counting of the heap allocations of the whole program by wrapping the 
+// allocation functions of the C library (operator new and Eigen use them)
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+}
+
+static std::atomic<long> allocationCount(0);
+
+extern "C" void* malloc(size_t size) {
+    allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    allocationCount++;
+    return __libc_realloc(pointer, size);
+}
+#endif
+
 void main1() {
 
     MegarenaPatternDetector detector(9, 12);
@@ -342,11 +370,162 @@ void test3d(int codeSize) {
             || areEqual(patternPose, estimatedPoses[3], 0.1))
 }
 
+void testTracking(int codeSize) {
+    START_UNIT_TEST;
+
+    // Constructing the layout
+    double physicalPeriod = randomDouble(5.0, 10.0);
+    PatternLayout* layout = new MegarenaPatternLayout(physicalPeriod, codeSize);
+    cout << "  Code size: " << codeSize << endl;
+    cout << "  Physical period: " << physicalPeriod << endl;
+
+    // Setting the pose of the pattern in the camera frame for rendering
+    double x = randomDouble(-layout->getWidth() + 6 * codeSize*physicalPeriod, -6 * codeSize * physicalPeriod);
+    double y = randomDouble(-layout->getHeight() + 6 * codeSize*physicalPeriod, -6 * codeSize * physicalPeriod);
+    double alpha = randomDouble(-PI, PI);
+    double pixelSize = randomDouble(1.0, 1.1);
+
+    MegarenaPatternDetector detector(physicalPeriod, codeSize);
+    detector.setTrackingMode(true);
+    Eigen::ArrayXXd array(512, 512);
+    for (int frame = 0; frame < 5; frame++) {
+        // moving of less than two periods between two frames
+        x += randomDouble(-2.0, 2.0) * physicalPeriod;
+        y += randomDouble(-2.0, 2.0) * physicalPeriod;
+        alpha += randomDouble(-0.05, 0.05);
+        Pose patternPose = Pose(x, y, alpha, pixelSize);
+        cout << "  Pattern pose:   " << patternPose.toString() << endl;
+
+        // Rendering
+        layout->renderOrthographicProjection(patternPose, array);
+
+        // Detecting and estimating the pose of the pattern
+        detector.compute(array);
+        Pose estimatedPose = detector.get2DPose();
+
+        // Printing results 
+        cout << "  Estimated pose: " << estimatedPose.toString() << (detector.isTracked() ? " (tracked)" : "") << endl;
+
+        TEST_EQUALITY(patternPose, estimatedPose, 0.01)
+        UNIT_TEST(detector.isTracked() == (frame > 0));
+    }
+
+    // large displacement: the tracking fails and the full decoding is used
+    x += 50 * physicalPeriod;
+    Pose patternPose = Pose(x, y, alpha, pixelSize);
+    layout->renderOrthographicProjection(patternPose, array);
+    detector.compute(array);
+    TEST_EQUALITY(patternPose, detector.get2DPose(), 0.01)
+    UNIT_TEST(!detector.isTracked());
+}
+
+/** Lights the image with a spot centered on (x, y) over a dimmer background, so that the fringes are stronger around the spot */
+static void lightSpot(Eigen::ArrayXXd & array, double x, double y, double radius) {
+    for (int col = 0; col < array.cols(); col++) {
+        for (int row = 0; row < array.rows(); row++) {
+            double distance2 = (col - x) * (col - x) + (row - y) * (row - y);
+            array(row, col) *= 0.5 + 0.5 * exp(-distance2 / (2 * radius * radius));
+        }
+    }
+}
+
+void testTrackingWindow(int codeSize) {
+    START_UNIT_TEST;
+
+    // Constructing the layout
+    double physicalPeriod = randomDouble(5.0, 10.0);
+    PatternLayout* layout = new MegarenaPatternLayout(physicalPeriod, codeSize);
+    cout << "  Code size: " << codeSize << endl;
+    cout << "  Physical period: " << physicalPeriod << endl;
+
+    double x = randomDouble(-layout->getWidth() + 6 * codeSize*physicalPeriod, -6 * codeSize * physicalPeriod);
+    double y = randomDouble(-layout->getHeight() + 6 * codeSize*physicalPeriod, -6 * codeSize * physicalPeriod);
+    double alpha = randomDouble(-PI, PI);
+    double pixelSize = randomDouble(1.0, 1.1);
+
+    // the window follows the spot where the fringes are the strongest while
+    // the pattern is translated
+    MegarenaPatternDetector detector(physicalPeriod, codeSize);
+    detector.setTrackingMode(true);
+    detector.setInt("trackingWindowSize", 256);
+    Eigen::ArrayXXd array(1024, 1024);
+    for (int frame = 0; frame < 5; frame++) {
+        x += randomDouble(-2.0, 2.0) * physicalPeriod;
+        y += randomDouble(-2.0, 2.0) * physicalPeriod;
+        Pose patternPose = Pose(x, y, alpha, pixelSize);
+        cout << "  Pattern pose:   " << patternPose.toString() << endl;
+
+        layout->renderOrthographicProjection(patternPose, array);
+        lightSpot(array, 400 + 80 * frame, 512, 100);
+        detector.compute(array);
+        Pose estimatedPose = detector.get2DPose();
+        cout << "  Estimated pose: " << estimatedPose.toString() << (detector.isTracked() ? " (tracked)" : "") << " (window at " << detector.getInt("windowX") << ", " << detector.getInt("windowY") << ")" << endl;
+
+        TEST_EQUALITY(patternPose, estimatedPose, 0.01)
+        UNIT_TEST(detector.getBool("windowTracked") == (frame > 0));
+    }
+    UNIT_TEST(detector.getInt("windowX") > 600);
+
+    // large displacement: the tracking fails and the thumbnail is computed
+    // from the phase maps of the whole image
+    x += 50 * physicalPeriod;
+    Pose patternPose = Pose(x, y, alpha, pixelSize);
+    layout->renderOrthographicProjection(patternPose, array);
+    lightSpot(array, 720, 512, 100);
+    detector.compute(array);
+    TEST_EQUALITY(patternPose, detector.get2DPose(), 0.01)
+    UNIT_TEST(!detector.isTracked() && !detector.getBool("windowTracked"));
+}
+
+void testAllocationFreeDecoding(int codeSize) {
+    START_UNIT_TEST;
+#ifdef __GLIBC__
+    // Constructing the layout
+    double physicalPeriod = randomDouble(5.0, 10.0);
+    MegarenaPatternLayout layout(physicalPeriod, codeSize);
+    cout << "  Code size: " << codeSize << endl;
+    cout << "  Physical period: " << physicalPeriod << endl;
+
+    // Rendering two images of the same size
+    double x = randomDouble(-layout.getWidth() + 3 * codeSize*physicalPeriod, -3 * codeSize * physicalPeriod);
+    double y = randomDouble(-layout.getHeight() + 3 * codeSize*physicalPeriod, -3 * codeSize * physicalPeriod);
+    double alpha = randomDouble(-0.1, 0.1);
+    Eigen::ArrayXXd array1(512, 512), array2(512, 512);
+    layout.renderOrthographicProjection(Pose(x, y, alpha, 1.0), array1);
+    layout.renderOrthographicProjection(Pose(x + 20 * physicalPeriod, y - 10 * physicalPeriod, alpha, 1.0), array2);
+
+    // Computing the first image allocates the workspaces, the second one must 
+    // reuse them: the absolute decoding must not allocate more than the phase
+    // computation of a periodic detector on the same image
+    MegarenaPatternDetector detector(physicalPeriod, codeSize);
+    PeriodicPatternDetector periodicDetector(physicalPeriod);
+    detector.compute(array1);
+    periodicDetector.compute(array1);
+    long count = allocationCount;
+    detector.compute(array2);
+    count = allocationCount - count;
+    long periodicCount = allocationCount;
+    periodicDetector.compute(array2);
+    periodicCount = allocationCount - periodicCount;
+    cout << "  Allocations: " << count << " (phase computation: " << periodicCount << ")" << endl;
+
+    // the reused workspaces give the same result as new ones
+    MegarenaPatternDetector newDetector(physicalPeriod, codeSize);
+    newDetector.compute(array2);
+
+    UNIT_TEST(count == periodicCount);
+    TEST_EQUALITY(detector.get2DPose(), newDetector.get2DPose(), 1e-9)
+#endif
+}
+
 void runAllTests() {
     REPEAT_TEST(test2d(8), 10)
     REPEAT_TEST(test2d(10), 10)
     REPEAT_TEST(test2d(12), 10)
     REPEAT_TEST(test3d(8), 10);
+    REPEAT_TEST(testTracking(12), 5);
+    REPEAT_TEST(testTrackingWindow(12), 5);
+    REPEAT_TEST(testAllocationFreeDecoding(12), 5);
 }
 
 double speed(unsigned long testCount) {
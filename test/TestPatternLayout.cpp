@@ -128,6 +128,100 @@ void main7() {
 //
 //}
 
+/** Returns the number of rectangles of a layout visited with a grid of tiles x tiles regions (plus a border of regions) */
+static size_t countTiledRectangles(PatternLayout & layout, int tiles) {
+    double tileWidth = layout.getDouble("width") / tiles;
+    double tileHeight = layout.getDouble("height") / tiles;
+    size_t count = 0;
+    for (int i = -1; i <= tiles; i++) {
+        for (int j = -1; j <= tiles; j++) {
+            layout.visitRectangles([&count](const Rectangle & rectangle) {
+                count++;
+            }, Rectangle(i * tileWidth, j * tileHeight, tileWidth, tileHeight));
+        }
+    }
+    return count;
+}
+
+/** Returns the intensity of a layout at (x, y) computed by summing the contributions of all its rectangles */
+static double sumIntensities(PatternLayout & layout, double x, double y) {
+    double intensity = 0.0;
+    double width = layout.getDouble("width");
+    double height = layout.getDouble("height");
+    layout.visitRectangles([&](const Rectangle & dot) {
+        if (x >= dot.x - 0.5 * dot.width && x <= dot.x + 1.5 * dot.width && y >= dot.y - 0.5 * dot.height && y <= dot.y + 1.5 * dot.height) {
+            intensity += (1 + cos(PI * (x - (dot.x + 0.5 * dot.width)) / dot.width)) * (1 + cos(PI * (y - (dot.y + 0.5 * dot.height)) / dot.height)) / 4;
+        }
+    }, Rectangle(-width, -height, 3 * width, 3 * height));
+    return intensity;
+}
+
+/** Returns the value of an attribute in a line of a SVG file */
+static std::string getSVGAttribute(const std::string & line, const std::string & name) {
+    size_t start = line.find(" " + name + "=\"");
+    if (start == std::string::npos) {
+        return "";
+    }
+    start += name.size() + 3;
+    return line.substr(start, line.find('"', start) - start);
+}
+
+/** Returns the number of dots of a SVG file with the rows filled with patterns
+ * expanded (the patterns must be defined after the drawing) and the number of 
+ * these rows
+ */
+static size_t countSVGDots(const std::string & filename, size_t & patternRowCount) {
+    std::ifstream file(filename);
+    std::string line;
+    std::vector<std::pair<std::string, double> > patternRows;
+    std::map<std::string, double> pitches;
+    size_t count = 0;
+    bool drawingEnded = false;
+    while (std::getline(file, line)) {
+        if (line.find("</g>") == 0) {
+            drawingEnded = true;
+        } else if (!drawingEnded && line.find("<rect x=") == 0) {
+            count++;
+        } else if (!drawingEnded && line.find("<rect transform=") == 0) {
+            std::string fill = getSVGAttribute(line, "fill");
+            patternRows.push_back(std::make_pair(fill.substr(5, fill.size() - 6), std::stod(getSVGAttribute(line, "width"))));
+        } else if (drawingEnded && line.find("<pattern id=") == 0) {
+            pitches[getSVGAttribute(line, "id")] = std::stod(getSVGAttribute(line, "width"));
+        }
+    }
+    patternRowCount = patternRows.size();
+    for (size_t i = 0; i < patternRows.size(); i++) {
+        if (pitches.count(patternRows[i].first) == 0) {
+            return 0;
+        }
+        count += (size_t) std::round(patternRows[i].second / pitches[patternRows[i].first]);
+    }
+    return count;
+}
+
+#ifndef WIN32
+/** Returns the number of dots of a GDS cell with all its references and repetitions expanded, and frees the cell */
+static size_t countGDSDots(gdstk::Cell * cell) {
+    gdstk::Array<gdstk::Polygon*> polygons = {};
+    cell->get_polygons(true, true, -1, true, gdstk::make_tag(1, 1), polygons);
+    size_t count = polygons.count;
+    for (uint64_t i = 0; i < polygons.count; i++) {
+        polygons[i]->clear();
+        gdstk::free_allocation(polygons[i]);
+    }
+    polygons.clear();
+
+    gdstk::Library library = {};
+    library.cell_array.append(cell);
+    gdstk::Map<gdstk::Cell*> dependencies = {};
+    cell->get_dependencies(true, dependencies);
+    dependencies.to_array(library.cell_array);
+    dependencies.clear();
+    library.free_all();
+    return count;
+}
+#endif
+
 void runAllTests() {
 
     START_UNIT_TEST;
@@ -139,6 +233,22 @@ void runAllTests() {
     layout1.saveToJSON("PeriodicPattern2.json");
     //    remove("PeriodicPattern.json");
     UNIT_TEST(areFilesEqual("PeriodicPattern.json", "PeriodicPattern2.json"));
+    UNIT_TEST(countTiledRectangles(layout1, 5) == layout1.countRectangles());
+
+    START_UNIT_TEST;
+    size_t patternRowCount1;
+    UNIT_TEST(countSVGDots("PeriodicPattern.svg", patternRowCount1) == layout1.countRectangles());
+    UNIT_TEST(patternRowCount1 > 0);
+
+    START_UNIT_TEST;
+    Pose renderingPose(1.0, 2.0, 0.3, 0.5);
+    Eigen::ArrayXXd rendered(64, 64), antialiased(64, 64);
+    layout1.renderOrthographicProjection(renderingPose, rendered);
+    layout1.supersampling = 3;
+    layout1.renderOrthographicProjection(renderingPose, antialiased);
+    layout1.supersampling = 1;
+    UNIT_TEST(antialiased.minCoeff() >= 0.0 && antialiased.maxCoeff() <= 1.0);
+    UNIT_TEST(std::abs(rendered.mean() - antialiased.mean()) < 0.05);
 
     START_UNIT_TEST;
     HPCodePatternLayout layout2(10, 37);
@@ -150,6 +260,21 @@ void runAllTests() {
     layout2.saveToJSON("HPCodePattern2.json");
     //    remove("HPCodePattern.json");
     UNIT_TEST(areFilesEqual("HPCodePattern.json", "HPCodePattern2.json"));
+    UNIT_TEST(countTiledRectangles(layout2, 7) == layout2.countRectangles());
+
+    START_UNIT_TEST;
+    double lastProgress = -1.0;
+    bool increasing = true;
+    layout2.setProgressCallback([&](const std::string & task, double progress) {
+        increasing = increasing && progress >= lastProgress;
+        lastProgress = progress;
+    });
+    layout2.saveToCSV("HPCodePatternTiled.csv");
+    layout2.setProgressCallback(PatternLayout::printProgress);
+    UNIT_TEST(increasing && lastProgress == 1.0);
+    std::ifstream csvFile("HPCodePatternTiled.csv");
+    size_t lineCount = std::count(std::istreambuf_iterator<char>(csvFile), std::istreambuf_iterator<char>(), '\n');
+    UNIT_TEST(lineCount == layout2.countRectangles() + 1);
 
     START_UNIT_TEST;
     MegarenaPatternLayout layout3(4.5, 6);
@@ -160,6 +285,37 @@ void runAllTests() {
     layout3.saveToJSON("MegarenaPattern2.json");
     //    remove("MegarenaPattern.json");
     UNIT_TEST(areFilesEqual("MegarenaPattern.json", "MegarenaPattern2.json"));
+    UNIT_TEST(countTiledRectangles(layout3, 10) == layout3.countRectangles());
+
+    START_UNIT_TEST;
+    size_t patternRowCount3;
+    UNIT_TEST(countSVGDots("MegarenaPattern.svg", patternRowCount3) == layout3.countRectangles());
+    UNIT_TEST(patternRowCount3 > 0);
+
+    START_UNIT_TEST;
+    layout3.pngBitDepth = 1;
+    layout3.saveToPNG("MegarenaPattern1bit.png");
+    layout3.pngBitDepth = 8;
+    cv::Mat image8 = cv::imread("MegarenaPattern.png", cv::IMREAD_GRAYSCALE);
+    cv::Mat image1 = cv::imread("MegarenaPattern1bit.png", cv::IMREAD_GRAYSCALE);
+    UNIT_TEST(image8.size() == image1.size() && cv::countNonZero(image8) > 0);
+    UNIT_TEST(cv::countNonZero(image8 != image1) == 0);
+
+#ifndef WIN32
+    START_UNIT_TEST;
+    layout3.saveToGDS("MegarenaPattern.gds");
+    layout3.saveToOASIS();
+    std::vector<Rectangle> rectangleList3;
+    layout3.toRectangleVector(rectangleList3);
+    UNIT_TEST(countGDSDots(layout3.convertToGDSCell()) == rectangleList3.size());
+    UNIT_TEST(countGDSDots(layout3.convertToOASISCell()) == rectangleList3.size());
+
+    START_UNIT_TEST;
+    layout1.saveToOASIS();
+    std::vector<Rectangle> rectangleList1;
+    layout1.toRectangleVector(rectangleList1);
+    UNIT_TEST(countGDSDots(layout1.convertToOASISCell()) == rectangleList1.size());
+#endif
 
     START_UNIT_TEST;
     FingerprintPatternLayout layout4("data/vernier37x37.png", 9);
@@ -180,6 +336,19 @@ void runAllTests() {
     layout5.saveToJSON("BitmapPattern2.json");
     //    remove("BitmapPattern.json");
     UNIT_TEST(areFilesEqual("BitmapPattern.json", "BitmapPattern2.json"));
+    UNIT_TEST(countTiledRectangles(layout5, 3) == layout5.countRectangles());
+
+    START_UNIT_TEST;
+    size_t dotCount5 = layout5.countRectangles();
+    layout5.mergeDots = true;
+    double mergedArea5 = 0.0;
+    layout5.visitAllRectangles([&mergedArea5](const Rectangle & rectangle) {
+        mergedArea5 += rectangle.width * rectangle.height;
+    });
+    UNIT_TEST(layout5.countRectangles() < dotCount5);
+    UNIT_TEST(std::abs(mergedArea5 - dotCount5 * layout5.dotSize * layout5.dotSize) < 1e-9 * mergedArea5);
+    UNIT_TEST(countTiledRectangles(layout5, 3) == layout5.countRectangles());
+    layout5.saveToSVG("BitmapPatternMerged.svg");
 
     START_UNIT_TEST;
     BitmapPatternLayout layout52("data/stamp69x69.png", 20);
@@ -201,6 +370,15 @@ void runAllTests() {
     //    remove("HPCodePattern.csv");
     UNIT_TEST(areFilesEqual("CustomPattern.json", "CustomPattern2.json"));
 
+    START_UNIT_TEST;
+    double maxError6 = 0.0;
+    for (double y = -2.0; y < layout6.getDouble("height") + 2.0; y += 0.37) {
+        for (double x = -2.0; x < layout6.getDouble("width") + 2.0; x += 0.53) {
+            maxError6 = std::max(maxError6, std::abs(layout6.getIntensity(x, y) - sumIntensities(layout6, x, y)));
+        }
+    }
+    UNIT_TEST(maxError6 == 0.0);
+
 }
 
 int main(int argc, char** argv) {
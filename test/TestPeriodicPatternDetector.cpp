@@ -139,6 +139,53 @@ void test2d() {
     TEST_EQUALITY(patternPose, estimatedPose, 0.01)
 }
 
+/** Lights the image with a spot centered on (x, y) over a dimmer background, so that the fringes are stronger around the spot */
+static void lightSpot(Eigen::ArrayXXd & array, double x, double y, double radius) {
+    for (int col = 0; col < array.cols(); col++) {
+        for (int row = 0; row < array.rows(); row++) {
+            double distance2 = (col - x) * (col - x) + (row - y) * (row - y);
+            array(row, col) *= 0.5 + 0.5 * exp(-distance2 / (2 * radius * radius));
+        }
+    }
+}
+
+void testTrackingWindow() {
+    START_UNIT_TEST;
+
+    double physicalPeriod = randomDouble(5.0, 10.0);
+    PatternLayout* layout = new PeriodicPatternLayout(physicalPeriod, 241, 241);
+    cout << "  Physical period: " << physicalPeriod << endl;
+
+    PatternDetector* detector;
+    detector = new PeriodicPatternDetector(physicalPeriod);
+    detector->setInt("trackingWindowSize", 256);
+
+    // first frame: the full image is computed to find the pattern
+    Pose patternPose = Pose(0.0, 0.0, randomDouble(0, PI / 2), randomDouble(1.0, 1.1));
+    Eigen::ArrayXXd array(1024, 1024);
+    layout->renderOrthographicProjection(patternPose, array);
+    lightSpot(array, 400, 512, 100);
+    detector->compute(array);
+    UNIT_TEST(detector->patternFound() && !detector->getBool("windowTracked"));
+
+    // next frames: only the window around the previous position is computed,
+    // the window follows the spot where the fringes are the strongest
+    for (int frame = 1; frame <= 4; frame++) {
+        patternPose.x = randomDouble(0.0, physicalPeriod / 2.01);
+        patternPose.y = randomDouble(0.0, physicalPeriod / 2.01);
+        cout << "  Pattern pose:   " << patternPose.toString() << endl;
+        layout->renderOrthographicProjection(patternPose, array);
+        lightSpot(array, 400 + 80 * frame, 512, 100);
+        detector->compute(array);
+        UNIT_TEST(detector->getBool("windowTracked"));
+
+        Pose estimatedPose = detector->get2DPose();
+        cout << "  Estimated pose: " << estimatedPose.toString() << " (window at " << detector->getInt("windowX") << ", " << detector->getInt("windowY") << ")" << endl;
+        TEST_EQUALITY(patternPose, estimatedPose, 0.01)
+    }
+    UNIT_TEST(detector->getInt("windowX") > 600);
+}
+
 int main(int argc, char** argv) {
 
     //main2d();
@@ -146,6 +193,8 @@ int main(int argc, char** argv) {
     //main3dPerspective();
     
     REPEAT_TEST(test2d(), 10)
+    
+    REPEAT_TEST(testTrackingWindow(), 10)
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -127,6 +127,23 @@ using namespace cv;
         UNIT_TEST(detector.codes.size() == 6);
     }
 
+    static void testTracking() {
+        
+        START_UNIT_TEST;
+        
+        QRCodeDetector detector;
+        detector.setTrackingMode(true);
+        Mat image = imread("data/QRCode/code14.jpg");
+
+        detector.compute(image);
+        UNIT_TEST(!detector.isTracked());
+        UNIT_TEST(detector.codes.size() == 1);
+
+        detector.compute(image);
+        UNIT_TEST(detector.isTracked());
+        UNIT_TEST(detector.codes.size() == 1);
+    }
+
     static double speed(unsigned long testCount) {
         QRCodeDetector detector;
         Mat image;
@@ -146,6 +163,7 @@ int main(int argc, char** argv) {
 //    cout << "Computing time: " << speed(100) << " ms" << endl;
     
     runAllTests();
+    testTracking();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -52,6 +52,39 @@ static void test(string filename, int lowCannyThreshold, int highCannyThreshold,
 
 }
 
+static void testRunLength(string filename, bool lightFinders, int numberOfMarkers) {
+
+    START_UNIT_TEST;
+    cv::Mat image = imread(filename);
+    cv::Mat original = image.clone();
+
+    QRFiducialDetector detector;
+    detector.runLengthScan = true;
+    detector.lightFinders = lightFinders;
+
+    detector.compute(image);
+    cout << "Found " << detector.fiducials.size() << " fiducials in " << filename << std::endl;
+    cout << detector.toString() << endl;
+
+    UNIT_TEST(detector.fiducials.size() == numberOfMarkers);
+    UNIT_TEST(cv::norm(image, original, cv::NORM_INF) == 0);
+}
+
+static void testGrayInput(string filename, int lowCannyThreshold, int highCannyThreshold) {
+
+    START_UNIT_TEST;
+    cv::Mat image = imread(filename, cv::IMREAD_GRAYSCALE);
+    cv::Mat original = image.clone();
+
+    QRFiducialDetector detector;
+    detector.lowCannyThreshold = lowCannyThreshold;
+    detector.highCannyThreshold = highCannyThreshold;
+
+    detector.compute(image);
+
+    UNIT_TEST(image.type() == CV_8UC1 && cv::norm(image, original, cv::NORM_INF) == 0);
+}
+
 double speed(unsigned long testCount) {
 
     QRFiducialDetector detector;
@@ -87,5 +120,15 @@ int main(int argc, char** argv) {
     test("data/QRCode/code31.jpg", 50, 110, 9);
     test("data/QRCode/code61.jpg", 100, 210, 18);
 
+    testGrayInput("data/QRCode/code11.jpg", 200, 400);
+
+    testRunLength("data/QRCode/code11.jpg", false, 3);
+    testRunLength("data/QRCode/code13.jpg", false, 3);
+    testRunLength("data/QRCode/code15.jpg", false, 3);
+    testRunLength("data/QRCode/code17.jpg", false, 3);
+    testRunLength("data/QRCode/code21.jpg", true, 6);
+    testRunLength("data/QRCode/code22.tif", true, 6);
+    testRunLength("data/QRCode/code23.png", true, 6);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
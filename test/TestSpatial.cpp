@@ -80,6 +80,91 @@ void runAllTests() {
     UNIT_TEST(areEqual(unwrappedReference, wrappedPhasePeak1));
 }
 
+/** Compares the snapshots with a pixel by pixel extraction, inside and across
+ *	the borders of the image
+ */
+void testSnapshot(int x, int y) {
+
+    START_UNIT_TEST;
+
+    int size = 128;
+    Eigen::ArrayXXd array = Eigen::ArrayXXd::Random(300, 500);
+    Eigen::ArrayXXd window = hannWindow(size, 4);
+    Eigen::ArrayXXd expected(size, size);
+    for (int col = 0; col < size; col++) {
+        for (int row = 0; row < size; row++) {
+            int arrayRow = y - size / 2 + row;
+            int arrayCol = x - size / 2 + col;
+            if (arrayRow >= 0 && arrayRow < array.rows() && arrayCol >= 0 && arrayCol < array.cols()) {
+                expected(row, col) = array(arrayRow, arrayCol);
+            } else {
+                expected(row, col) = 0.0;
+            }
+        }
+    }
+
+    Eigen::ArrayXXd snapshot;
+    takeSnapshot(x, y, size, array, snapshot);
+    UNIT_TEST(areEqual(expected, snapshot));
+
+    Eigen::ArrayXXcd windowedSnapshot;
+    takeWindowedSnapshot(x, y, array, window, windowedSnapshot);
+    Eigen::ArrayXXcd windowedExpected = (expected * window).cast<std::complex<double> >();
+    UNIT_TEST(areEqual(windowedExpected, windowedSnapshot));
+}
+
+/** Compares the neighbourhood search in a uniform grid with an exhaustive 
+ *	search, for points and rectangles
+ */
+void testUniformGrid(int itemCount) {
+
+    START_UNIT_TEST;
+
+    std::vector<cv::Point2d> points(itemCount);
+    std::vector<Rectangle> rectangles(itemCount);
+    for (int i = 0; i < itemCount; i++) {
+        points[i] = cv::Point2d(randomDouble(-100, 400), randomDouble(50, 250));
+        rectangles[i] = Rectangle(points[i].x, points[i].y, randomDouble(0, 30), randomDouble(0, 30));
+    }
+
+    UniformGrid pointGrid, rectangleGrid;
+    pointGrid.build(points, 1.0, 4.0);
+    rectangleGrid.build(rectangles, 10.0, 4.0);
+
+    bool found = true;
+    for (int k = 0; k < 100; k++) {
+        double x = randomDouble(-150, 450);
+        double y = randomDouble(0, 300);
+        double radius = randomDouble(0, 50);
+        std::vector<int> neighbours;
+        pointGrid.findItems(Rectangle(x - radius, y - radius, 2 * radius, 2 * radius), neighbours);
+        for (int i = 0; i < itemCount; i++) {
+            if (std::abs(points[i].x - x) <= radius && std::abs(points[i].y - y) <= radius) {
+                found = found && std::find(neighbours.begin(), neighbours.end(), i) != neighbours.end();
+            }
+        }
+
+        // the rectangles containing the point are listed in its cell in increasing order
+        std::vector<int> expected, listed;
+        for (int i = 0; i < itemCount; i++) {
+            if (x >= rectangles[i].x && x <= rectangles[i].x + rectangles[i].width && y >= rectangles[i].y && y <= rectangles[i].y + rectangles[i].height) {
+                expected.push_back(i);
+            }
+        }
+        int cell = rectangleGrid.getCell(x, y);
+        if (cell >= 0) {
+            for (int j = rectangleGrid.cellStarts[cell]; j < rectangleGrid.cellStarts[cell + 1]; j++) {
+                int i = rectangleGrid.cellItems[j];
+                if (x >= rectangles[i].x && x <= rectangles[i].x + rectangles[i].width && y >= rectangles[i].y && y <= rectangles[i].y + rectangles[i].height) {
+                    listed.push_back(i);
+                }
+            }
+        }
+        found = found && listed == expected;
+    }
+    UNIT_TEST(found);
+}
+
 /* Runs a given amount of times the unwrapping function
  *
  *	\params testCount: number of times the function quartersUnwrapping will run
@@ -113,5 +198,14 @@ int main(int argc, char** argv) {
 
     runAllTests();
 
+    testSnapshot(250, 150);
+    testSnapshot(10, 150);
+    testSnapshot(480, 290);
+    testSnapshot(-100, 150);
+
+    testUniformGrid(0);
+    testUniformGrid(1);
+    testUniformGrid(500);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
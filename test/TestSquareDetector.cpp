@@ -27,7 +27,7 @@ void main1() {
     cv::waitKey(0);
 }
 
-void test(string filename, int numberOfMarkers) {
+void test(string filename, int numberOfMarkers, bool stopOnStableCandidates = false) {
     START_UNIT_TEST;
             
     cv::Mat grayImage, image = cv::imread(filename);
@@ -40,6 +40,7 @@ void test(string filename, int numberOfMarkers) {
     grayImage.convertTo(grayImage, CV_8UC1);
 
     SquareDetector detector;
+    detector.parameters.stopOnStableCandidates = stopOnStableCandidates;
     detector.compute(grayImage);
 
     cout << "    Found " << detector.squares.size() << " squares in " << filename << endl;
@@ -47,6 +48,52 @@ void test(string filename, int numberOfMarkers) {
     UNIT_TEST(detector.squares.size() == numberOfMarkers);
 }
 
+void testTracking(string filename, int numberOfMarkers) {
+    START_UNIT_TEST;
+
+    cv::Mat grayImage, image = cv::imread(filename);
+    if (image.channels() > 1) {
+        cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+    } else {
+        grayImage = image;
+    }
+    cv::normalize(grayImage, grayImage, 255, 0, cv::NORM_MINMAX);
+    grayImage.convertTo(grayImage, CV_8UC1);
+
+    SquareDetector detector;
+    detector.setTrackingMode(true);
+    detector.compute(grayImage);
+    UNIT_TEST(!detector.isTracked());
+
+    // second frame searched around the squares of the first one
+    detector.compute(grayImage);
+    UNIT_TEST(detector.isTracked());
+    UNIT_TEST(detector.squares.size() == numberOfMarkers);
+}
+
+void testTrackerUpdate() {
+    START_UNIT_TEST;
+
+    MarkerTracker tracker;
+    tracker.trackingMode = true;
+    vector<Point2d> centers = {Point2d(100, 100), Point2d(300, 100)};
+    vector<double> radii = {20, 20};
+    UNIT_TEST(tracker.update(centers, radii, true));
+
+    // markers moved within their radius, and a new marker
+    vector<Point2d> movedCenters = {Point2d(110, 95), Point2d(290, 112), Point2d(500, 500)};
+    vector<double> movedRadii = {20, 20, 20};
+    UNIT_TEST(tracker.update(movedCenters, movedRadii, false));
+
+    // a marker lost and replaced by another one: same count but not tracked
+    vector<Point2d> lostCenters = {Point2d(110, 95), Point2d(290, 112), Point2d(700, 100)};
+    UNIT_TEST(!tracker.update(lostCenters, movedRadii, false));
+
+    // a marker found too far from its previous position
+    vector<Point2d> farCenters = {Point2d(110, 95), Point2d(290, 112), Point2d(530, 500)};
+    UNIT_TEST(!tracker.update(farCenters, movedRadii, false));
+}
+
 double speed(unsigned long testCount) {
 
     SquareDetector detector;
@@ -75,6 +122,10 @@ int main(int argc, char** argv) {
 
     test("data/QRCode/code14.jpg", 1);
     test("data/QRCode/code17.jpg", 7);
+    test("data/QRCode/code14.jpg", 1, true);
+    test("data/QRCode/code17.jpg", 7, true);
+    testTracking("data/QRCode/code17.jpg", 7);
+    testTrackerUpdate();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
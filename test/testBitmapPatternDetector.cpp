@@ -100,6 +100,40 @@ void test2d(const string & filename) {
     UNIT_TEST(areEqual(patternPose, estimatedPose, 0.5));
 }
 
+void testTemplateMatching(const string & filename) {
+
+    START_UNIT_TEST;
+
+    // Rendering
+    double physicalPeriod = randomDouble(4., 8.0);
+    BitmapPatternLayout layout(filename, physicalPeriod);
+    Pose patternPose = Pose(randomDouble(-90, 90), randomDouble(-90, 90), randomDouble(-PI, PI), randomDouble(1.0, 1.1));
+    Eigen::ArrayXXd array(512, 512);
+    layout.renderOrthographicProjection(patternPose, array);
+
+    // Detecting
+    BitmapPatternDetector detector(physicalPeriod, filename);
+    detector.compute(array);
+
+    // Matching the thumbnail with OpenCV
+    cv::Mat thumbnail = *(cv::Mat*) detector.getObject("thumbnail");
+    std::vector<cv::Mat> bitmap = *(std::vector<cv::Mat>*) detector.getObject("bitmap");
+    double maxmaxVal = -1;
+    int bitmapIndex = -1;
+    for (int k = 0; k < bitmap.size(); k++) {
+        cv::Mat result;
+        cv::matchTemplate(thumbnail, bitmap[k], result, cv::TM_CCOEFF);
+        double maxVal;
+        cv::minMaxLoc(result, NULL, &maxVal);
+        if (maxVal > maxmaxVal) {
+            maxmaxVal = maxVal;
+            bitmapIndex = k;
+        }
+    }
+
+    UNIT_TEST(bitmapIndex == detector.getInt("bitmapIndex"));
+}
+
 int main(int argc, char** argv) {
 
 //    main1();
@@ -110,5 +144,7 @@ int main(int argc, char** argv) {
     
     REPEAT_TEST(test2d("data/femto117x45.png"), 20);
 
+    REPEAT_TEST(testTemplateMatching("data/femto117x45.png"), 5);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
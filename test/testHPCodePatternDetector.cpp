@@ -8,6 +8,9 @@
 #include "HPCodePatternLayout.hpp"
 #include "UnitTest.hpp"
 #include <iomanip>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace vernier;
 using namespace std;
@@ -184,12 +187,42 @@ void test(string filename, int lowCannyThreshold, int highCannyThreshold, int nu
 
 }
 
+void testParallel(string filename, int lowCannyThreshold, int highCannyThreshold, int numberOfHalfPeriod, int snapshotSize) {
+
+    START_UNIT_TEST;
+    cv::Mat image = imread(filename);
+
+    HPCodePatternDetector parallel(15.5, numberOfHalfPeriod, snapshotSize);
+    parallel.detector.fiducialDetector.lowCannyThreshold = lowCannyThreshold;
+    parallel.detector.fiducialDetector.highCannyThreshold = highCannyThreshold;
+    parallel.compute(image);
+
+    HPCodePatternDetector serial(15.5, numberOfHalfPeriod, snapshotSize);
+    serial.detector.fiducialDetector.lowCannyThreshold = lowCannyThreshold;
+    serial.detector.fiducialDetector.highCannyThreshold = highCannyThreshold;
+#ifdef _OPENMP
+    int threadCount = omp_get_max_threads();
+    omp_set_num_threads(1);
+    serial.compute(image);
+    omp_set_num_threads(threadCount);
+#else
+    serial.compute(image);
+#endif
+
+    UNIT_TEST(parallel.markers.size() == serial.markers.size());
+    for (map<int, Pose>::iterator it = parallel.markers.begin(); it != parallel.markers.end(); it++) {
+        UNIT_TEST(serial.patternFound(it->first));
+        UNIT_TEST(areEqual(it->second, serial.get2DPose(it->first), 1e-9));
+    }
+}
+
 void runAllTests() {
     test("data/QRCode/code17.jpg", 100, 200, 1, 37, 512);
     test("data/QRCode/code23.png", 200, 400, 2, 33, 512);
     test("data/QRCode/code24.png", 100, 300, 2, 33, 512);
     test("data/QRCode/code31.jpg", 50, 100, 3, 37, 256);
     test("data/QRCode/code61.jpg", 100, 210, 6, 37, 256);
+    testParallel("data/QRCode/code61.jpg", 100, 210, 37, 256);
     REPEAT_TEST(test2d(33), 10)
     REPEAT_TEST(test2d(37), 10)
 
@@ -8,12 +8,31 @@
 #include "Layout.hpp"
 #include "UnitTest.hpp"
 #include <iomanip>
+#include <algorithm>
 #include <opencv4/opencv2/core/mat.hpp>
 
 using namespace vernier;
 using namespace std;
 using namespace cv;
 
+/** Detector whose index ignores some bitmaps, so that they are never shortlisted */
+class ForgetfulStampPatternDetector : public StampPatternDetector {
+public:
+
+    ForgetfulStampPatternDetector(double physicalPeriod, const std::string & filename, int snapshotSize)
+    : StampPatternDetector(physicalPeriod, filename, snapshotSize) {
+    }
+
+    void forgetRotation(int rotation) {
+        for (std::pair<const unsigned int, std::vector<int> >& entry : patternIndex) {
+            std::vector<int>& bitmaps = entry.second;
+            bitmaps.erase(std::remove_if(bitmaps.begin(), bitmaps.end(), [rotation](int k) {
+                return k % 4 == rotation;
+            }), bitmaps.end());
+        }
+    }
+};
+
 void main1() {
     
     string filename = "data/stamp/stamp3.png";
@@ -94,6 +113,108 @@ void test2d() {
     UNIT_TEST(areEqual(patternPose.alpha, estimatedPose.alpha, 0.2));
 }
 
+void testIdentification() {
+
+    START_UNIT_TEST;
+
+    // Constructing the layout of one of the stamps
+    string filenames[] = {"data/stamp/stampD.png", "data/stamp/stampG.png", "data/stamp/stampF.png", "data/stamp/stamp+.png"};
+    int id = rand() % 4;
+    double physicalPeriod = randomDouble(7.0, 8.0);
+    PatternLayout* layout = new BitmapPatternLayout(filenames[id], physicalPeriod);
+    cout << "  Stamp: " << filenames[id] << endl;
+
+    // Setting the pose of the pattern in the camera frame for rendering
+    double x = randomDouble(-200, 200);
+    double y = randomDouble(-200, 200);
+    double alpha = randomDouble(-PI, PI);
+    double pixelSize = randomDouble(1.0, 1.5);
+    Pose patternPose = Pose(x, y, alpha, pixelSize);
+    cout << "  Pattern pose: " << patternPose.toString() << endl;
+
+    // Rendering
+    Eigen::ArrayXXd array(1024, 1024);
+    layout->renderOrthographicProjection(patternPose, array);
+
+    // Detecting (the 16 bitmaps exceed the shortlist of 8 candidates)
+    StampPatternDetector detector(physicalPeriod, filenames[0], 420);
+    for (int k = 1; k < 4; k++) {
+        detector.addBitmap(filenames[k]);
+    }
+    detector.compute(array);
+
+    Pose estimatedPose;
+    if (detector.patternFound(id)) {
+        estimatedPose = detector.get2DPose(id);
+        cout << "  Estimated pose: " << estimatedPose << endl;
+    }
+
+    UNIT_TEST(detector.patternCount() == 1);
+    UNIT_TEST(detector.patternFound(id));
+    UNIT_TEST(detector.getInt("shortlistedCount") == 1);
+    UNIT_TEST(areEqual(patternPose.x, estimatedPose.x, 0.2));
+    UNIT_TEST(areEqual(patternPose.y, estimatedPose.y, 0.2));
+    UNIT_TEST(areEqual(patternPose.alpha, estimatedPose.alpha, 0.2));
+
+    // a correlation threshold that cannot be reached forces the full search
+    detector.setDouble("minCorrelation", 1.1);
+    detector.compute(array);
+    UNIT_TEST(detector.getInt("shortlistedCount") == 0);
+    UNIT_TEST(detector.patternFound(id));
+    UNIT_TEST(areEqual(estimatedPose.x, detector.get2DPose(id).x, 1e-9));
+}
+
+void testFallback() {
+
+    START_UNIT_TEST;
+
+    // Constructing the layout of one of the stamps
+    string filenames[] = {"data/stamp/stampD.png", "data/stamp/stampG.png", "data/stamp/stampF.png", "data/stamp/stamp+.png"};
+    int id = rand() % 4;
+    double physicalPeriod = randomDouble(7.0, 8.0);
+    PatternLayout* layout = new BitmapPatternLayout(filenames[id], physicalPeriod);
+    cout << "  Stamp: " << filenames[id] << endl;
+
+    // Setting the pose of the pattern in the camera frame for rendering
+    double x = randomDouble(-200, 200);
+    double y = randomDouble(-200, 200);
+    double alpha = randomDouble(-PI, PI);
+    double pixelSize = randomDouble(1.0, 1.5);
+    Pose patternPose = Pose(x, y, alpha, pixelSize);
+    cout << "  Pattern pose: " << patternPose.toString() << endl;
+
+    // Rendering
+    Eigen::ArrayXXd array(1024, 1024);
+    layout->renderOrthographicProjection(patternPose, array);
+
+    // Detecting once to find the rotation of the stamp
+    ForgetfulStampPatternDetector detector(physicalPeriod, filenames[0], 420);
+    for (int k = 1; k < 4; k++) {
+        detector.addBitmap(filenames[k]);
+    }
+    detector.compute(array);
+    int bitmapIndex = detector.getInt("bitmapIndex");
+    UNIT_TEST(bitmapIndex / 4 == id);
+
+    // the shortlist now misses all the stamps in this rotation, the correlation
+    // of the other rotations is too low and the full search finds the stamp
+    detector.forgetRotation(bitmapIndex % 4);
+    detector.compute(array);
+
+    Pose estimatedPose;
+    if (detector.patternFound(id)) {
+        estimatedPose = detector.get2DPose(id);
+        cout << "  Estimated pose: " << estimatedPose << endl;
+    }
+
+    UNIT_TEST(detector.getInt("shortlistedCount") == 0);
+    UNIT_TEST(detector.getInt("bitmapIndex") == bitmapIndex);
+    UNIT_TEST(detector.patternFound(id));
+    UNIT_TEST(areEqual(patternPose.x, estimatedPose.x, 0.2));
+    UNIT_TEST(areEqual(patternPose.y, estimatedPose.y, 0.2));
+    UNIT_TEST(areEqual(patternPose.alpha, estimatedPose.alpha, 0.2));
+}
+
 double speed(unsigned long testCount) {
 
     // Constructing the layout
@@ -135,6 +256,10 @@ int main(int argc, char** argv) {
 
     REPEAT_TEST(test2d(), 20);
     
+    REPEAT_TEST(testIdentification(), 20);
+
+    REPEAT_TEST(testFallback(), 20);
+    
     //testFile("data/stamp/stamp2.png", 2);
 
     return EXIT_SUCCESS;